@@ -0,0 +1,116 @@
+#!/bin/bash
+### compile_time.sh
+### compile-time regression benchmark of LLVMHW1 and LLVMHW2 on the 583 suite
+### Times both passes on 583simple, 583wc and 583compress with -time-passes and
+### compares the result against a stored baseline. LLVMHW1 runs on the IR it
+### sees in newRun.sh and runtime.sh, after the unrolling pipeline; LLVMHW2
+### runs fplicm-correctness on the unoptimized bitcode, as in the homework.
+### usage: ./compile_time.sh ${LLVMHW1.so} ${LLVMHW2.so} ${opt} ${benchmark_dir} ${output_dir} ${baseline.csv}
+### ${benchmark_dir} holds the 583* directories, e.g. HW1_template.
+### HW1_TIMING_TRIALS=5           opt runs per pass and benchmark; the median is kept
+### HW1_TIMING_TOLERANCE=0.25     relative slowdown that counts as a regression
+### HW1_TIMING_SLACK=0.002        seconds a phase may grow regardless, for noise
+### HW1_TIMING_PIPELINE=...       function passes run before hw1, by default the
+###                               unrolling pipeline of newRun.sh
+### HW1_UPDATE_BASELINE=1         write this run to ${baseline.csv} instead of comparing
+###
+### Results: compile_time.csv with one row per benchmark, pass and phase. The
+### LLVMHW1 phases (seed collection, graph construction, monotonic annotation,
+### legality and cost model, code generation, ...) come from the pass's own
+### timer group; "pass" is the pass's total from the pass timing report.
+### Bitcode is built with clang when it exists, else the prebuilt
+### ${benchmark_dir}/583*/<name>.bc is used with optnone removed. Exits with 1
+### when any row regressed.
+
+PATH_HW1=${1}
+PATH_HW2=${2}
+OPT=${3}
+BENCH_DIR=${4}
+OUT=${5}
+BASELINE=${6}
+TRIALS=${HW1_TIMING_TRIALS:-5}
+TOLERANCE=${HW1_TIMING_TOLERANCE:-0.25}
+SLACK=${HW1_TIMING_SLACK:-0.002}
+PIPELINE=${HW1_TIMING_PIPELINE:-mem2reg,simplifycfg,lcssa,loop-simplify,loop(loop-rotate),loop-unroll}
+BENCHMARKS="simple wc compress"
+LLVM_BIN=$(dirname ${OPT})
+CLANG=${CLANG:-$(command -v clang || command -v ${LLVM_BIN}/clang)}
+
+mkdir -p ${OUT}
+cd ${OUT}
+
+# unoptimized bitcode of one benchmark, which the passes can still change
+bitcode(){
+if [[ -n "${CLANG}" && -x "${CLANG}" ]]; then
+${CLANG} -O0 -Xclang -disable-O0-optnone -emit-llvm -c ${BENCH_DIR}/583${1}/src/${1}.c -o ${1}.bc
+elif [[ -f ${BENCH_DIR}/583${1}/${1}.bc ]]; then
+${LLVM_BIN}/llvm-dis ${BENCH_DIR}/583${1}/${1}.bc -o - | sed 's/ optnone//' | ${LLVM_BIN}/llvm-as -o ${1}.bc
+else
+return 1
+fi
+}
+
+# prints "pass,phase,seconds" for every row of a -time-passes report that
+# belongs to the pass under test; the wall time is the last column
+phases(){
+sed -n -E '/LLVMHW1 phases/,/ Total$/ s/^.*[[:space:]]([0-9.]+) \( *[0-9.]+%\)  (.*)$/'${2}',\2,\1/p
+/HW1Pass$|FPLICMNewPass$/ s/^.*[[:space:]]([0-9.]+) \( *[0-9.]+%\)  .*$/'${2}',pass,\1/p' ${1} | grep -v ',Total,'
+}
+
+rm -f trials.csv
+for bench in ${BENCHMARKS}; do
+  if ! bitcode ${bench} 2> /dev/null; then
+    echo "${bench}: no clang and no prebuilt ${bench}.bc, skipped"
+    continue
+  fi
+  ${OPT} -passes="function(${PIPELINE})" -unroll-count=3 -unroll-allow-partial ${bench}.bc -o ${bench}.unrolled.bc || exit 1
+  for trial in $(seq ${TRIALS}); do
+    ${OPT} -load ${PATH_HW1} -load-pass-plugin=${PATH_HW1} -passes=hw1 -time-passes \
+      -info-output-file=hw1.txt ${bench}.unrolled.bc -o /dev/null || exit 1
+    # fplicm-correctness also redirects stores outside the loop to the value
+    # it hoists into the preheader, which does not verify on 583wc; only its
+    # time is wanted here
+    ${OPT} -load ${PATH_HW2} -load-pass-plugin=${PATH_HW2} -passes='loop-simplify,fplicm-correctness' -time-passes \
+      -disable-verify -info-output-file=hw2.txt ${bench}.bc -o /dev/null || exit 1
+    { phases hw1.txt LLVMHW1; phases hw2.txt LLVMHW2; } | sed "s/^/${bench},/" >> trials.csv
+  done
+  rm -f ${bench}.bc ${bench}.unrolled.bc hw1.txt hw2.txt
+done
+if [[ ! -s trials.csv ]]; then
+  echo "No benchmark could be timed"
+  exit 1
+fi
+
+# median over the trials
+echo "bench,pass,phase,seconds" > compile_time.csv
+sort -t, -k1,3 -k4,4g trials.csv | awk -F, '
+function flush() { if (n) printf "%s,%.6f\n", key, (v[int((n + 1) / 2)] + v[int(n / 2) + 1]) / 2 }
+{ k = $1 "," $2 "," $3; if (k != key) { flush(); key = k; n = 0 } v[++n] = $4 }
+END { flush() }' >> compile_time.csv
+rm -f trials.csv
+
+if [[ "${HW1_UPDATE_BASELINE}" == "1" ]]; then
+  cp compile_time.csv ${BASELINE}
+  echo "Wrote baseline ${BASELINE}"
+  exit 0
+fi
+if [[ ! -f ${BASELINE} ]]; then
+  cat compile_time.csv
+  echo "No baseline at ${BASELINE}; run with HW1_UPDATE_BASELINE=1 to record one"
+  exit 0
+fi
+
+awk -F, -v tol=${TOLERANCE} -v slack=${SLACK} '
+FNR == 1 { next }
+NR == FNR { base[$1 "," $2 "," $3] = $4; next }
+{
+  k = $1 "," $2 "," $3
+  if (!(k in base)) { printf "%-10s %-8s %-30s %10s %10.4f %8s\n", $1, $2, $3, "-", $4, "new"; next }
+  change = base[k] > 0 ? sprintf("%+.0f%%", 100 * ($4 - base[k]) / base[k]) : "-"
+  bad = $4 > base[k] * (1 + tol) && $4 - base[k] > slack
+  printf "%-10s %-8s %-30s %10.4f %10.4f %8s%s\n", $1, $2, $3, base[k], $4, change, bad ? "  REGRESSION" : ""
+  regressions += bad
+}
+BEGIN { printf "%-10s %-8s %-30s %10s %10s %8s\n", "bench", "pass", "phase", "baseline", "seconds", "change" }
+END { if (regressions) { printf "%d regression(s) over %.0f%%\n", regressions, 100 * tol; exit 1 } }' ${BASELINE} compile_time.csv | tee compile_time.txt
+exit ${PIPESTATUS[0]}
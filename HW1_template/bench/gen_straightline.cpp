@@ -0,0 +1,98 @@
+//===-- Straight-line code generator for the loop rolling pass ------------===//
+//
+// Writes a function made of N unrolled, isomorphic statements, as LLVM IR or
+// as C, for measuring how LLVMHW1 scales with the size of a seed group.
+//
+// usage: hw1-gen {store|call|struct|mixed} N [c|ir]
+//
+//   store   a[k] = x + k;
+//   call    use(k);
+//   struct  use(p[k / 8].f<k % 8>);    fields of one type at a regular stride
+//   mixed   runs of 8 statements of each of the above in turn
+//
+//===----------------------------------------------------------------------===//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+enum Shape { STORE, CALL, STRUCT, MIXED };
+
+const unsigned FIELDS = 8;  // fields of the struct shape
+const unsigned RUN = 8;     // statements of one shape in a row, for mixed
+
+Shape shape_of(unsigned k, Shape shape) {
+    return shape == MIXED ? (Shape) ((k / RUN) % 3) : shape;
+}
+
+void emit_ir(Shape shape, unsigned n) {
+    std::printf("target datalayout = \"e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128\"\n");
+    std::printf("target triple = \"x86_64-pc-linux-gnu\"\n\n");
+    std::printf("%%struct.S = type { ");
+    for (unsigned f = 0; f < FIELDS; ++f) std::printf("%si32", f ? ", " : "");
+    std::printf(" }\n\n");
+    std::printf("@a = global [%u x i32] zeroinitializer\n\n", n);
+    std::printf("declare void @use(i32)\n\n");
+    std::printf("define void @f(i32 %%x, %%struct.S* %%p) {\nentry:\n");
+    for (unsigned k = 0; k < n; ++k) {
+        switch (shape_of(k, shape)) {
+        case STORE:
+            std::printf("  %%v%u = add i32 %%x, %u\n", k, k);
+            std::printf("  store i32 %%v%u, i32* getelementptr ([%u x i32], [%u x i32]* @a, i64 0, i64 %u)\n", k, n, n, k);
+            break;
+        case CALL:
+            std::printf("  call void @use(i32 %u)\n", k);
+            break;
+        default:
+            std::printf("  %%f%u = getelementptr %%struct.S, %%struct.S* %%p, i64 %u, i32 %u\n", k, k / FIELDS, k % FIELDS);
+            std::printf("  %%l%u = load i32, i32* %%f%u\n", k, k);
+            std::printf("  call void @use(i32 %%l%u)\n", k);
+            break;
+        }
+    }
+    std::printf("  ret void\n}\n");
+}
+
+void emit_c(Shape shape, unsigned n) {
+    std::printf("struct S {");
+    for (unsigned f = 0; f < FIELDS; ++f) std::printf(" int f%u;", f);
+    std::printf(" };\n\n");
+    std::printf("int a[%u];\n", n);
+    std::printf("void use(int);\n\n");
+    std::printf("void f(int x, struct S *p) {\n");
+    for (unsigned k = 0; k < n; ++k) {
+        switch (shape_of(k, shape)) {
+        case STORE:  std::printf("  a[%u] = x + %u;\n", k, k); break;
+        case CALL:   std::printf("  use(%u);\n", k); break;
+        default:     std::printf("  use(p[%u].f%u);\n", k / FIELDS, k % FIELDS); break;
+        }
+    }
+    std::printf("}\n");
+}
+
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 4) {
+        std::fprintf(stderr, "usage: %s {store|call|struct|mixed} N [c|ir]\n", argv[0]);
+        return 1;
+    }
+    const char *names[] = {"store", "call", "struct", "mixed"};
+    int shape = -1;
+    for (int s = 0; s < 4; ++s) {
+        if (!std::strcmp(argv[1], names[s])) shape = s;
+    }
+    char *end;
+    unsigned long n = std::strtoul(argv[2], &end, 10);
+    std::string format = argc == 4 ? argv[3] : "ir";
+    if (shape < 0 || *end || n == 0 || (format != "c" && format != "ir")) {
+        std::fprintf(stderr, "%s: bad arguments\n", argv[0]);
+        return 1;
+    }
+
+    if (format == "c") emit_c((Shape) shape, n);
+    else emit_ir((Shape) shape, n);
+    return 0;
+}
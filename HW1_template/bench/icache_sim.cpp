@@ -0,0 +1,157 @@
+//===-- Instruction cache simulator for one command -----------------------===//
+//
+// Single-steps a command under ptrace and feeds the address of every
+// instruction it executes to a set-associative LRU instruction cache. Prints
+// "<instructions> <line fetches> <misses>" on stderr once the command exits,
+// which is what the runtime benchmark records when hardware counters are not
+// available. A fetch is counted when execution moves to another cache line,
+// so straight-line code within a line costs one fetch.
+//
+// Only the first -steps instructions are simulated; the command then runs to
+// completion untraced and the instruction count equals the limit.
+//
+// Reads the program counter on x86-64 and AArch64 Linux.
+//
+// usage: hw1-icache [-size KB] [-ways N] [-line B] [-steps N] command [args...]
+//
+//===----------------------------------------------------------------------===//
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// address of the next instruction the stopped command runs
+bool program_counter(pid_t pid, uint64_t &pc) {
+#if defined(__x86_64__)
+    struct user_regs_struct regs;
+    if (ptrace(PTRACE_GETREGS, pid, nullptr, &regs) < 0) return false;
+    pc = regs.rip;
+#elif defined(__aarch64__)
+    struct user_regs_struct regs;
+    struct iovec io = {&regs, sizeof(regs)};
+    if (ptrace(PTRACE_GETREGSET, pid, (void *) NT_PRSTATUS, &io) < 0) return false;
+    pc = regs.pc;
+#else
+#error "hw1-icache reads the program counter on x86-64 and AArch64 only"
+#endif
+    return true;
+}
+
+// set-associative cache with LRU replacement; each set keeps its tags in
+// order of last use, most recent first
+class ICache {
+public:
+    ICache(unsigned sizeKB, unsigned ways, unsigned line)
+        : ways(ways), line(line), sets(sizeKB * 1024 / (ways * line)), tags(sets * ways, ~0ull) {}
+
+    bool valid() const {
+        return sets && ways && line && !(line & (line - 1)) && !(sets & (sets - 1));
+    }
+
+    // returns true on a miss
+    bool access(uint64_t address) {
+        uint64_t block = address / line;
+        uint64_t *set = &tags[(block & (sets - 1)) * ways];
+        unsigned way = 0;
+        while (way < ways && set[way] != block) ++way;
+        bool miss = way == ways;
+        if (miss) way = ways - 1;
+        for (; way > 0; --way) set[way] = set[way - 1];
+        set[0] = block;
+        return miss;
+    }
+
+    const unsigned ways;
+    const unsigned line;
+
+private:
+    const unsigned sets;
+    std::vector<uint64_t> tags;
+};
+
+}
+
+int main(int argc, char **argv) {
+    unsigned sizeKB = 32, ways = 8, line = 64;
+    unsigned long long steps = 100000000;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        unsigned long long value = std::strtoull(argv[arg + 1], nullptr, 10);
+        if (!std::strcmp(argv[arg], "-size")) sizeKB = value;
+        else if (!std::strcmp(argv[arg], "-ways")) ways = value;
+        else if (!std::strcmp(argv[arg], "-line")) line = value;
+        else if (!std::strcmp(argv[arg], "-steps")) steps = value;
+        else break;
+    }
+    ICache cache(sizeKB, ways, line);
+    if (arg >= argc || !cache.valid()) {
+        std::fprintf(stderr, "usage: %s [-size KB] [-ways N] [-line B] [-steps N] command [args...]\n", argv[0]);
+        std::fprintf(stderr, "sets and line size must be powers of two\n");
+        return 1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        execvp(argv[arg], argv + arg);
+        std::perror(argv[arg]);
+        _exit(127);
+    }
+
+    // the first stop is the exec
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status)) {
+        std::fprintf(stderr, "%s: could not trace %s\n", argv[0], argv[arg]);
+        return 1;
+    }
+
+    unsigned long long instructions = 0, fetches = 0, misses = 0;
+    uint64_t lastLine = ~0ull;
+    int signal = 0;
+    while (true) {
+        if (instructions == steps) {
+            ptrace(PTRACE_DETACH, pid, nullptr, (void *) (long) signal);
+            waitpid(pid, &status, 0);
+            break;
+        }
+        uint64_t pc;
+        if (!program_counter(pid, pc)) {
+            std::perror("ptrace");
+            return 1;
+        }
+        ++instructions;
+        if (pc / line != lastLine) {
+            lastLine = pc / line;
+            ++fetches;
+            if (cache.access(pc)) ++misses;
+        }
+
+        ptrace(PTRACE_SINGLESTEP, pid, nullptr, (void *) (long) signal);
+        if (waitpid(pid, &status, 0) < 0) {
+            std::perror("waitpid");
+            return 1;
+        }
+        if (WIFEXITED(status) || WIFSIGNALED(status)) break;
+        // signals other than the single-step trap belong to the command
+        signal = WSTOPSIG(status) == SIGTRAP ? 0 : WSTOPSIG(status);
+    }
+
+    std::fprintf(stderr, "%llu %llu %llu\n", instructions, fetches, misses);
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    return 128 + WTERMSIG(status);
+}
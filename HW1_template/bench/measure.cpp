@@ -0,0 +1,45 @@
+//===-- Wall time and peak memory of one command --------------------------===//
+//
+// Runs a command and prints "<seconds> <peak RSS in KB>" on stderr once it
+// exits, which is what the scaling benchmark records for every opt run.
+// Takes the place of GNU time, which is not installed everywhere.
+//
+// usage: hw1-measure command [args...]
+//
+//===----------------------------------------------------------------------===//
+#include <chrono>
+#include <cstdio>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s command [args...]\n", argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        execvp(argv[1], argv + 1);
+        std::perror(argv[1]);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        std::perror("wait4");
+        return 1;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::fprintf(stderr, "%.4f %ld\n", elapsed.count(), usage.ru_maxrss);
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    return 128 + WTERMSIG(status);
+}
@@ -0,0 +1,161 @@
+#!/bin/bash
+### runtime.sh
+### runtime benchmark of code rolled by LLVMHW1
+### Builds every 583 benchmark and test program twice, with the same pipeline
+### with and without -hw1, and compares text size, wall time and instruction
+### cache misses of the two binaries.
+### usage: ./runtime.sh ${hw1-measure} ${hw1-icache} ${LLVMHW1.so} ${opt} ${benchmark_dir} ${output_dir}
+### ${benchmark_dir} holds the 583* and test directories, e.g. HW1_template.
+### Inputs are taken from ${benchmark_dir}/583*/input1, or from the 583*/input1
+### next to ${benchmark_dir} when a program has none of its own.
+### HW1_RUNTIME_TRIALS=5          runs per binary; the median wall time is kept
+### HW1_RUNTIME_PIPELINE=...      function passes run before hw1, by default the
+###                               unrolling pipeline of newRun.sh
+### HW1_ICACHE_ARGS="-size 32 -ways 8 -line 64 -steps 20000000"
+###                               cache and step limit of hw1-icache
+###
+### Results: runtime.csv with one row per program and variant, and runtime.txt,
+### the summary table. I-cache misses are L1-icache-load-misses from perf stat
+### when the counters can be read, else simulated by hw1-icache over the first
+### -steps instructions, loader and libc included. ${hw1-icache} is "none" on
+### hosts the simulator does not support; without perf the misses are then "-".
+### Both binaries must print the same output, write the same files and exit
+### with the same status; "output" says so. A 583 program that exits with
+### another status than in exec_info_input1, writes to stderr or produces no
+### output at all stops the benchmark, since its times would be those of the
+### error path.
+### Bitcode is built with clang when it exists, else the prebuilt <name>.bc is
+### used with optnone removed; programs that have neither are skipped.
+
+MEASURE=${1}
+ICACHE=${2}
+PATH_MYPASS=${3}
+OPT=${4}
+BENCH_DIR=${5}
+OUT=${6}
+TRIALS=${HW1_RUNTIME_TRIALS:-5}
+PIPELINE=${HW1_RUNTIME_PIPELINE:-mem2reg,simplifycfg,lcssa,loop-simplify,loop(loop-rotate),loop-unroll}
+ICACHE_ARGS=${HW1_ICACHE_ARGS:--size 32 -ways 8 -line 64 -steps 20000000}
+LLVM_BIN=$(dirname ${OPT})
+CLANG=${CLANG:-$(command -v clang || command -v ${LLVM_BIN}/clang)}
+CC=${CC:-cc}
+
+# program, its directory, its exit status and its arguments, as in
+# exec_info_input1; the test programs print nothing and return what they
+# computed, so their status is only compared between the two binaries ("-")
+PROGRAMS="simple:583simple:1: wc:583wc:0:cccp.c compress:583compress:0:compress.in"
+if [[ -n "${CLANG}" && -x "${CLANG}" ]]; then
+  for src in ${BENCH_DIR}/test/src/*.c; do PROGRAMS+=" $(basename ${src} .c):test:-:"; done
+else
+  PROGRAMS+=" test:test:-:"
+fi
+
+if perf stat -x, -e instructions,L1-icache-load-misses true > /dev/null 2>&1; then
+  ICACHE_TOOL=perf
+elif [[ -x ${ICACHE} ]]; then
+  ICACHE_TOOL=hw1-icache
+else
+  ICACHE_TOOL=none
+fi
+
+mkdir -p ${OUT}
+cd ${OUT}
+
+# unoptimized bitcode of one program, which the passes can still change
+bitcode(){
+local src=${BENCH_DIR}/${2}/src/${1}.c
+if [[ -n "${CLANG}" && -x "${CLANG}" && -f ${src} ]]; then
+${CLANG} -O0 -Xclang -disable-O0-optnone -emit-llvm -c ${src} -o ${1}.bc
+elif [[ -f ${BENCH_DIR}/${2}/${1}.bc ]]; then
+${LLVM_BIN}/llvm-dis ${BENCH_DIR}/${2}/${1}.bc -o - | sed 's/ optnone//' | ${LLVM_BIN}/llvm-as -o ${1}.bc
+else
+return 1
+fi
+}
+
+# directory of the inputs of one program, if it has any
+inputs(){
+for input in ${BENCH_DIR}/${1}/input1 ${BENCH_DIR}/../${1}/input1; do
+  [[ -d ${input} ]] && echo ${input} && return
+done
+}
+
+# runs one binary in a fresh directory holding the program's inputs;
+# prints the checksum of its output and of the files it wrote, and returns
+# the exit status of the command
+run(){
+local dir=${1} bin=${2} input=$(inputs ${1}); shift 2
+rm -rf run && mkdir run
+[[ -n ${input} ]] && ln -s ${input}/* run/
+(cd run && "$@" ../${bin} ${ARGS} > stdout)
+local status=$?
+find run -type f | sort | xargs cat | cksum | cut -d' ' -f1
+return ${status}
+}
+
+# cksum of no bytes at all
+EMPTY=4294967295
+
+# prints "<instructions> <line fetches> <misses>" of one run; perf does not
+# count fetches, so that column is "-"
+icache(){
+if [[ ${ICACHE_TOOL} == perf ]]; then
+run ${1} ${2} perf stat -x, -o ../perf.txt -e instructions,L1-icache-load-misses > /dev/null
+awk -F, '$3 ~ /^instructions/ { i = $1 } $3 ~ /icache/ { m = $1 } END { print i, "-", m }' perf.txt
+elif [[ ${ICACHE_TOOL} == hw1-icache ]]; then
+run ${1} ${2} ${ICACHE} ${ICACHE_ARGS} 2> icache.txt > /dev/null
+tail -n 1 icache.txt
+else
+echo "- - -"
+fi
+}
+
+echo "program,variant,text_bytes,seconds,instructions,icache_fetches,icache_misses,output" > runtime.csv
+for entry in ${PROGRAMS}; do
+  IFS=: read name dir STATUS ARGS <<< "${entry}"
+  if ! bitcode ${name} ${dir} 2> /dev/null; then
+    echo "${name}: no clang and no prebuilt ${name}.bc, skipped"
+    continue
+  fi
+  for variant in unrolled rolled; do
+    passes="function(${PIPELINE})"
+    [[ ${variant} == rolled ]] && passes="function(${PIPELINE},hw1)"
+    ${OPT} -load ${PATH_MYPASS} -load-pass-plugin=${PATH_MYPASS} -passes="${passes}" -unroll-count=3 -unroll-allow-partial \
+      ${name}.bc -o ${name}.${variant}.bc || exit 1
+    ${LLVM_BIN}/llc -O2 -filetype=obj -relocation-model=pic ${name}.${variant}.bc -o ${name}.${variant}.o || exit 1
+    ${CC} ${name}.${variant}.o -o ${name}.${variant} -lm || exit 1
+    text=$(${LLVM_BIN}/llvm-size -A ${name}.${variant}.o | awk '$1 == ".text" { print $2 }')
+
+    output=$(run ${dir} ${name}.${variant} 2> stderr.txt)
+    status=$?
+    if [[ -s stderr.txt || ( ${STATUS} != - && ( ${status} != ${STATUS} || ${output} == ${EMPTY} ) ) ]]; then
+      echo "${name} ${variant}: failed on its input (exit status ${status}), nothing to time"
+      cat stderr.txt
+      exit 1
+    fi
+    output+="/${status}"
+    for trial in $(seq ${TRIALS}); do
+      run ${dir} ${name}.${variant} ${MEASURE} 2>&1 > /dev/null | tail -n 1 | cut -d' ' -f1
+    done > times.txt
+    seconds=$(sort -g times.txt | awk '{ v[NR] = $1 } END { printf "%.4f", (v[int((NR + 1) / 2)] + v[int(NR / 2) + 1]) / 2 }')
+    read instructions fetches misses < <(icache ${dir} ${name}.${variant})
+
+    echo "${name},${variant},${text},${seconds},${instructions},${fetches},${misses},${output}" >> runtime.csv
+    echo "${name} ${variant}: ${text} bytes of text, ${seconds} s, ${misses} I-cache misses"
+  done
+  rm -rf ${name}.bc ${name}.*.bc ${name}.*.o run times.txt icache.txt perf.txt stderr.txt
+done
+
+awk -F, -v tool=${ICACHE_TOOL} '
+function change(a, b) { return a > 0 && a != "-" ? sprintf("%+.1f%%", 100 * (b - a) / a) : "-" }
+NR == 1 { next }
+$2 == "unrolled" { split($0, u, ","); next }
+$1 == u[1] {
+  printf "%-12s %8d %8d %8s %9.4f %9.4f %8s %9s %9s %8s  %s\n", $1, u[3], $3, change(u[3], $3), u[4], $4, change(u[4], $4),
+         u[7], $7, change(u[7], $7), u[8] == $8 ? "same" : "DIFFERS"
+}
+BEGIN {
+  printf "I-cache misses from %s\n", tool
+  printf "%-12s %8s %8s %8s %9s %9s %8s %9s %9s %8s  %s\n", "program", "text", "rolled", "change", "seconds", "rolled", "change",
+         "misses", "rolled", "change", "output"
+}' runtime.csv | tee runtime.txt
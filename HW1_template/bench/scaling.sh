@@ -0,0 +1,80 @@
+#!/bin/bash
+### scaling.sh
+### compile-time scaling benchmark of LLVMHW1
+### Runs the pass over straight-line functions of N isomorphic statements, for
+### every shape hw1-gen knows, and records wall time and peak memory against N.
+### usage: ./scaling.sh ${hw1-gen} ${hw1-measure} ${LLVMHW1.so} ${opt} ${output_dir}
+### The sizes can be changed with HW1_SCALING_SIZES="10 100 1000".
+###
+### Results: scaling.csv with one row per run, and scaling.txt, which charts
+### the pass time per statement. The pass time is the opt run minus an opt run
+### that loads the plugin but only parses and verifies the same file. The
+### growth column is the exponent k in time ~ N^k between two sizes; values
+### well above 1 point at super-linear graph construction. scaling.png is
+### drawn when gnuplot exists.
+
+GEN=${1}
+MEASURE=${2}
+PATH_MYPASS=${3}
+OPT=${4}
+OUT=${5}
+SIZES=${HW1_SCALING_SIZES:-10 100 1000 10000 100000}
+SHAPES="store call struct mixed"
+
+mkdir -p ${OUT}
+cd ${OUT}
+
+# prints "<seconds> <peak RSS in KB>" of one opt run
+measure(){
+${MEASURE} ${OPT} "$@" -o /dev/null 2>&1 >/dev/null | tail -n 1
+}
+
+echo "shape,n,pass_seconds,pass_rss_kb,opt_seconds,opt_rss_kb,parse_seconds,parse_rss_kb" > scaling.csv
+for shape in ${SHAPES}; do
+  for n in ${SIZES}; do
+    ${GEN} ${shape} ${n} ir > ${shape}_${n}.ll || exit 1
+    read parse_s parse_kb < <(measure -load ${PATH_MYPASS} -load-pass-plugin=${PATH_MYPASS} -passes=verify ${shape}_${n}.ll)
+    read opt_s opt_kb < <(measure -load ${PATH_MYPASS} -load-pass-plugin=${PATH_MYPASS} -passes=hw1 ${shape}_${n}.ll)
+    pass_s=$(awk -v a=${opt_s} -v b=${parse_s} 'BEGIN { d = a - b; printf "%.4f", d < 0 ? 0 : d }')
+    pass_kb=$(( opt_kb > parse_kb ? opt_kb - parse_kb : 0 ))
+    echo "${shape},${n},${pass_s},${pass_kb},${opt_s},${opt_kb},${parse_s},${parse_kb}" >> scaling.csv
+    echo "${shape} N=${n}: ${pass_s} s, ${pass_kb} KB over parsing"
+    rm -f ${shape}_${n}.ll
+  done
+done
+
+awk -F, 'NR > 1 {
+  rows[++count] = $0; per = $3 * 1e6 / $2
+  if (per > max[$1]) max[$1] = per
+}
+END {
+  for (r = 1; r <= count; ++r) {
+    split(rows[r], f, ",")
+    if (f[1] != shape) { printf "\n%s\n%8s %10s %10s %7s  %s\n", f[1], "N", "us/stmt", "KB", "growth", "time per statement"; shape = f[1]; prev_n = 0 }
+    per = f[3] * 1e6 / f[2]
+    growth = (prev_n && prev_t > 0 && f[3] > 0) ? sprintf("%.2f", log(f[3] / prev_t) / log(f[2] / prev_n)) : "-"
+    bar = ""; for (i = 0; max[f[1]] > 0 && i < 50 * per / max[f[1]]; ++i) bar = bar "#"
+    printf "%8d %10.2f %10d %7s  %s\n", f[2], per, f[4], growth, bar
+    prev_n = f[2]; prev_t = f[3]
+  }
+}' scaling.csv | tee scaling.txt
+
+if command -v gnuplot > /dev/null; then
+gnuplot <<EOF
+set terminal png size 1000,400
+set output 'scaling.png'
+set datafile separator ','
+set logscale xy
+set key left top
+set multiplot layout 1,2
+set title 'LLVMHW1 pass time'
+set xlabel 'N'
+set ylabel 'seconds'
+plot for [s in "${SHAPES}"] '< grep ^'.s.', scaling.csv' using 2:3 with linespoints title s
+set title 'LLVMHW1 peak memory over parsing'
+set ylabel 'KB'
+plot for [s in "${SHAPES}"] '< grep ^'.s.', scaling.csv' using 2:4 with linespoints title s
+unset multiplot
+EOF
+echo "Created scaling.png"
+fi
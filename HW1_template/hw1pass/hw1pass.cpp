@@ -1,4 +1,14 @@
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/GlobalValue.h"
@@ -6,40 +16,132 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Use.h"
 #include "llvm/IR/Value.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Pass.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/PassTimingInfo.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/BlockFrequencyInfo.h"
 #include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/Analysis/DomTreeUpdater.h"
+#include "llvm/Analysis/LoopAccessAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/ThreadPool.h"
  #include "llvm-c/Core.h"
 #include <cstdint>
 #include <map>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 
 using namespace llvm;
+
+#define DEBUG_TYPE "hw1"
+
+ALWAYS_ENABLED_STATISTIC(NumSeeds, "Seed groups collected");
+ALWAYS_ENABLED_STATISTIC(NumMatched, "Seed groups whose members align");
+ALWAYS_ENABLED_STATISTIC(NumRolled, "Seed groups rolled into loops");
+ALWAYS_ENABLED_STATISTIC(NumVectorized, "Seed groups turned into vector code");
+ALWAYS_ENABLED_STATISTIC(NumRerolled, "Unrolled loops rerolled");
+ALWAYS_ENABLED_STATISTIC(NumRemoved, "Instructions removed by rolling");
+ALWAYS_ENABLED_STATISTIC(CacheHits, "Functions whose roll decisions were replayed from -hw1-cache-dir");
+ALWAYS_ENABLED_STATISTIC(CacheMisses, "Functions planned from scratch with -hw1-cache-dir");
+
+static cl::opt<bool> HashConsGraph("hw1-dag", cl::init(true),
+    cl::desc("Share identical operand groups between seeds instead of building one tree per seed"));
+
+static cl::opt<unsigned> MaxGraphDepth("hw1-max-depth", cl::init(64),
+    cl::desc("Maximum operand depth explored when building and walking alignment graphs"));
+
+static cl::opt<bool> ConstantTables("hw1-constant-tables", cl::init(true),
+    cl::desc("Roll groups that only differ in arbitrary constants by loading them from a table"));
+
+static cl::opt<double> HotBlockRatio("hw1-hot-ratio", cl::init(8.0),
+    cl::desc("Blocks executed at least this many times per function entry (from the profile) are only rolled partially"));
+
+static cl::opt<unsigned> UnrollFactor("hw1-unroll-factor", cl::init(0),
+    cl::desc("Copies of the group kept in every iteration of a rolled loop (0: 1, or -hw1-hot-unroll-factor in hot blocks)"));
+
+static cl::opt<unsigned> HotUnrollFactor("hw1-hot-unroll-factor", cl::init(4),
+    cl::desc("Copies kept per iteration when rolling in a hot block (0: leave hot groups unrolled)"));
+
+static cl::opt<int> MinSizeGain("hw1-min-size-gain", cl::init(1),
+    cl::desc("Minimum TTI code-size saving a group must yield to be rolled"));
+
+static cl::opt<int> MaxLatencyIncrease("hw1-max-latency-increase", cl::init(-1),
+    cl::desc("Maximum increase, in percent, of the TTI latency of a rolled group over the unrolled one (-1: no limit)"));
+
+static cl::opt<bool> Vectorize("hw1-vectorize", cl::init(true),
+    cl::desc("Emit vector code instead of a loop for store groups over consecutive memory when it is smaller, or faster in a hot block"));
+
+static cl::opt<bool> ReorderOperands("hw1-reorder-operands", cl::init(true),
+    cl::desc("Align the operands of commutative operators and compares before matching them"));
+
+static cl::opt<bool> WidenCasts("hw1-widen-casts", cl::init(true),
+    cl::desc("Match sext/zext groups whose sources differ only in width"));
+
+static cl::opt<bool> Reroll("hw1-reroll", cl::init(true),
+    cl::desc("Reroll single-block loops that hold several unrolled copies of their body"));
+
+static cl::opt<bool> IndirectCalls("hw1-indirect-calls", cl::init(false),
+    cl::desc("Roll calls to different functions of one type into a loop over a table of function pointers"));
+
+static cl::opt<double> IndirectCallPenalty("hw1-indirect-call-penalty", cl::init(2.0),
+    cl::desc("Cycles an indirect call through a function table costs over a direct call, averaged over predicted and mispredicted calls"));
+
+static cl::opt<double> ICacheUnitCost("hw1-icache-unit-cost", cl::init(4.0),
+    cl::desc("Cycles one unit of TTI code size is assumed to cost per function entry in I-cache misses"));
+
+static cl::opt<unsigned> Threads("hw1-threads", cl::init(0),
+    cl::desc("Worker threads of -passes=hw1-module (0: one per hardware thread)"));
+
+static cl::opt<std::string> CacheDir("hw1-cache-dir", cl::init(""),
+    cl::desc("Directory keeping the roll decisions of every function by structural hash, so unchanged functions skip planning"));
+
+static cl::opt<bool> PrintCode("hw1-print-code", cl::init(false),
+    cl::desc("Print every function before and after rolling"));
+
+static cl::opt<bool> PrintGraph("hw1-print-graph", cl::init(false),
+    cl::desc("Print the alignment graph of every seed group"));
+
+static cl::opt<bool> DecisionLog("hw1-decision-log", cl::init(false),
+    cl::desc("Print for every seed group whether it was rolled and why"));
+
+static cl::opt<bool> ReportSize("hw1-report-size", cl::init(false),
+    cl::desc("Report the instruction count of every function before and after rolling"));
+
+static cl::opt<bool> DefaultPipeline("hw1-in-default-pipeline", cl::init(false),
+    cl::desc("Also run the pass at the end of the scalar optimizer of the -O1 and higher pipelines"));
+
 namespace{
 
-    struct hash_pair {
-        size_t operator()(const std::pair<Value*, Type::TypeID>& p) const
-        {
-            auto hash1 = std::hash<Value*>{}(p.first);
-            auto hash2 = std::hash<Type::TypeID>{}(p.second);
-    
-            if (hash1 != hash2) {
-                return hash1 ^ hash2;             
-            }
-            
-            return hash1;
-        }
-    };
+    // -time-passes reports the phases of the pass in a group of its own
+    const char *const TimerGroupName = "hw1";
+    const char *const TimerGroupDescription = "LLVMHW1 phases";
 
     enum NodeType {
         INSTRUCTION,
@@ -49,7 +151,10 @@ namespace{
 
     enum NodeFlag {
         NONE,
-        MONOTONIC_CONSTANTS
+        MONOTONIC_CONSTANTS,
+        MONOTONIC_OFFSETS,  // base + monotonic constant offsets, e.g. unrolled indices
+        MONOTONIC_ELEMENTS, // constant GEPs into one object, e.g. &a[0], &a[1], ...
+        CONSTANT_TABLE      // unrelated constants, loaded from a private table
     };
 
     enum MonotonicOp {
@@ -64,63 +169,429 @@ namespace{
         MonotonicOp monotonic_op;
     };
 
+    typedef unsigned NodeId;
+
     struct Node {
-        std::vector<Value*> values;
-        std::vector<Node> edges;
+        // values and edges live in the owning AlignmentGraph's pools
+        unsigned value_begin;
+        unsigned num_values;
+        unsigned edge_begin;
+        unsigned num_edges;
         bool is_match;
+        bool annotated;
         NodeType type;
         NodeFlag flag;
 
         // extra info (may not always exist, check NodeFlag before accessing)
         MonotonicInfo monotonicInfo;
+        Value *offset_base;
     };
 
-	struct HW1: public FunctionPass {
-        static char ID;
-		HW1() : FunctionPass(ID) {
+    // Flat node arena shared by every seed group of a function. Nodes refer to
+    // their operand groups by index, so the graph is built once and annotated
+    // in place instead of being copied around as nested vectors.
+    struct AlignmentGraph {
+        std::vector<Node> nodes;
+        std::vector<Value*> value_pool;
+        std::vector<NodeId> edge_pool;
+        std::vector<NodeId> roots;
+        // hash of the ordered value tuple -> nodes holding that tuple
+        std::unordered_map<size_t, SmallVector<NodeId, 1>> intern_table;
+
+        NodeId add_node(ArrayRef<Value*> group, bool is_match) {
+            Node n = Node();
+            n.value_begin = value_pool.size();
+            n.num_values = group.size();
+            n.is_match = is_match;
+            n.type = NodeType::OTHER;
+            n.flag = NodeFlag::NONE;
+            value_pool.insert(value_pool.end(), group.begin(), group.end());
+            nodes.push_back(n);
+            return nodes.size() - 1;
         }
 
-        void getAnalysisUsage(AnalysisUsage &AU) const{
-            AU.addRequired<BlockFrequencyInfoWrapperPass>(); // Analysis pass to load block execution count
-            AU.addRequired<BranchProbabilityInfoWrapperPass>();  // Analysis pass to load branch probability
+        // reserves the edge slots of a node up front so they stay contiguous
+        void reserve_edges(NodeId id, unsigned count) {
+            nodes[id].edge_begin = edge_pool.size();
+            nodes[id].num_edges = count;
+            edge_pool.resize(edge_pool.size() + count);
         }
 
-        bool check_monotonic(std::vector<Value*> &group) {
-            std::vector<int64_t> int_vals;
-            for (Value *C: group) {
-                ConstantInt *ci = (ConstantInt*) C;
-                int_vals.push_back(ci->getLimitedValue());
+        ArrayRef<Value*> values(NodeId id) const {
+            const Node &n = nodes[id];
+            return makeArrayRef(value_pool).slice(n.value_begin, n.num_values);
+        }
+
+        ArrayRef<NodeId> edges(NodeId id) const {
+            const Node &n = nodes[id];
+            return makeArrayRef(edge_pool).slice(n.edge_begin, n.num_edges);
+        }
+
+        NodeId edge(NodeId id, unsigned i) const {
+            return edge_pool[nodes[id].edge_begin + i];
+        }
+
+        static size_t hash_group(ArrayRef<Value*> group) {
+            return hash_combine_range(group.begin(), group.end());
+        }
+
+        bool lookup(ArrayRef<Value*> group, NodeId &id) const {
+            auto it = intern_table.find(hash_group(group));
+            if (it == intern_table.end()) return false;
+            for (NodeId candidate: it->second) {
+                if (values(candidate) == group) {
+                    id = candidate;
+                    return true;
+                }
             }
-            int64_t diff = int_vals[1] - int_vals[0];
-            for (int k = 1; k < group.size() - 1; ++k) {
-                if (int_vals[k + 1] - int_vals[k] != diff) return false; 
+            return false;
+        }
+
+        void intern(NodeId id) {
+            intern_table[hash_group(values(id))].push_back(id);
+        }
+    };
+
+    // Everything generateLoop needs to roll one seed group. Plans for all
+    // groups are made before the function is modified.
+    struct RollPlan {
+        NodeId root;
+        unsigned seed;                     // index of the seed group
+        std::vector<NodeId> body;          // matched instruction nodes, in first member order
+        std::vector<NodeId> sequences;     // monotonic constant and constant table nodes
+        SmallPtrSet<Instruction*, 32> erase; // original instructions replaced by the loop
+        SetVector<Instruction*> dead;      // offsets of later members that only the group uses
+        Instruction *first;                // earliest instruction of the group
+        Instruction *last;                 // last root
+        unsigned trip_count;               // iterations of the rolled loop
+        unsigned unroll;                   // members handled per iteration
+        unsigned vector_width;             // lanes per vector if vectorized instead, else 0
+        bool indirect;                     // calls through a table of functions
+        Type *iv_type;                     // type of the induction variable
+        std::vector<NodeId> vector_nodes;  // body nodes computed as vectors
+        const char *reason;                // why the group is not rolled
+        int64_t size[2];                   // TTI code size unrolled / rolled
+        int64_t latency[2];                // TTI latency unrolled / rolled
+    };
+
+    struct WalkFrame {
+        NodeId id;
+        unsigned level;
+        unsigned next_edge;
+    };
+
+    // Explicit-stack depth-first walk shared by every graph phase, so deep
+    // expression chains cannot overflow the native stack. pre(id, level) runs
+    // when a node is reached and returns false to skip its operands;
+    // post(id, level) runs once all of its operands have been walked.
+    template <typename PreFn, typename PostFn>
+    void walk_graph(const AlignmentGraph &graph, NodeId root, PreFn pre, PostFn post) {
+        SmallVector<WalkFrame, 32> stack;
+        auto push = [&](NodeId id, unsigned level) {
+            bool descend = pre(id, level) && level < MaxGraphDepth;
+            stack.push_back({id, level, descend ? 0 : graph.nodes[id].num_edges});
+        };
+
+        push(root, 0);
+        while (!stack.empty()) {
+            WalkFrame &top = stack.back();
+            if (top.next_edge < graph.nodes[top.id].num_edges) {
+                NodeId child = graph.edge(top.id, top.next_edge++);
+                push(child, top.level + 1);
+            } else {
+                post(top.id, top.level);
+                stack.pop_back();
+            }
+        }
+    }
+
+    template <typename PreFn>
+    void walk_graph(const AlignmentGraph &graph, NodeId root, PreFn pre) {
+        walk_graph(graph, root, pre, [](NodeId, unsigned) {});
+    }
+
+    // The rolling transform itself. It is shared by the legacy HW1 pass and
+    // the new pass manager HW1Pass, which only differ in how they obtain the
+    // analyses below.
+    struct LoopRoller {
+        BlockFrequencyInfo *BFI = nullptr;
+        BranchProbabilityInfo *BPI = nullptr;
+        TargetTransformInfo *TTI = nullptr;
+        ScalarEvolution *SE = nullptr;
+        DominatorTree *DT = nullptr;
+        PostDominatorTree *PDT = nullptr;
+        LoopInfo *LI = nullptr;
+        OptimizationRemarkEmitter *ORE = nullptr;
+
+        // Dumps and decisions go to Log. When functions are planned
+        // concurrently, the module driver gives every function its own
+        // buffer and passes a lock that is held around everything that may
+        // create types, constants or SCEVs in the shared LLVMContext.
+        // Remarks go through the context's diagnostic handler, so they are
+        // only emitted from the serial phases.
+        raw_ostream *Log = &errs();
+        std::mutex *ContextLock = nullptr;
+
+        std::unique_lock<std::mutex> lock_context() {
+            return ContextLock ? std::unique_lock<std::mutex>(*ContextLock) : std::unique_lock<std::mutex>();
+        }
+
+        // Timers are not thread safe, so phases are not timed while the
+        // module driver decides functions concurrently.
+        bool timing() const {
+            return TimePassesIsEnabled && !ContextLock;
+        }
+
+        // Whether BB runs often enough, per entry of its function, that the
+        // branch and induction update of a rolled loop would cost more than
+        // the smaller code saves. Only profiled functions are judged: static
+        // estimates make every loop body look hot, and unrolled loop bodies
+        // are exactly what this pass wants to roll.
+        bool is_hot(BasicBlock *BB) const {
+            Function *F = BB->getParent();
+            if (!BFI || !F->hasProfileData()) return false;
+            uint64_t entry = BFI->getBlockFreq(&F->getEntryBlock()).getFrequency();
+            if (entry == 0) return false;
+            return (double) BFI->getBlockFreq(BB).getFrequency() >= HotBlockRatio * entry;
+        }
+
+        // program order of the instructions, numbered once per function
+        DenseMap<Instruction*, unsigned> position;
+
+        static bool is_uniform(ArrayRef<Value*> group) {
+            for (Value *V: group) {
+                if (V != group[0]) return false;
+            }
+            return true;
+        }
+
+        // Recognises integer constants c[k] = start + k * increment, in any
+        // order and with any sign of increment. The arithmetic is done on
+        // APInts in the constants' own width, wrapping the way the rolled loop
+        // recomputes them; start and increment must fit in 64 signed bits.
+        static bool check_monotonic(ArrayRef<Value*> group, MonotonicInfo &info) {
+            if (group.size() < 2) return false;
+            ConstantInt *C0 = dyn_cast<ConstantInt>(group[0]);
+            ConstantInt *C1 = dyn_cast<ConstantInt>(group[1]);
+            if (!C0 || !C1 || C0->getType() != C1->getType()) return false;
+            const APInt &start = C0->getValue();
+            APInt increment = C1->getValue() - start;
+            APInt expected = start;
+            for (Value *V: group) {
+                ConstantInt *ci = dyn_cast<ConstantInt>(V);
+                if (!ci || ci->getType() != C0->getType() || ci->getValue() != expected) return false;
+                expected += increment;
             }
+            const APInt &end = cast<ConstantInt>(group.back())->getValue();
+            if (!start.isSignedIntN(64) || !increment.isSignedIntN(64) || !end.isSignedIntN(64)) return false;
+            info = {start.getSExtValue(), end.getSExtValue(), increment.getSExtValue(), MonotonicOp::ADD};
             return true;
         }
 
-        bool check_monotonic_mul(std::vector<Value*> &group) {
-            std::vector<int64_t> int_vals;
+        // Recognises geometric constants c[k + 1] = c[k] * ratio, wrapping in
+        // the constants' width like the rolled loop's multiplications do.
+        static bool check_monotonic_mul(ArrayRef<Value*> group, MonotonicInfo &info) {
+            if (group.size() < 2) return false;
+            ConstantInt *C0 = dyn_cast<ConstantInt>(group[0]);
+            ConstantInt *C1 = dyn_cast<ConstantInt>(group[1]);
+            if (!C0 || !C1 || C0->getType() != C1->getType()) return false;
+            const APInt &start = C0->getValue();
+            if (start.isZero()) return false;  // exit, cannot start from 0
+            APInt ratio, remainder;
+            APInt::sdivrem(C1->getValue(), start, ratio, remainder);
+            if (!remainder.isZero() || ratio.isOne()) return false;  // trivial case, not considered multiplication
+
+            APInt expected = start;
+            for (Value *V: group) {
+                ConstantInt *ci = dyn_cast<ConstantInt>(V);
+                if (!ci || ci->getType() != C0->getType() || ci->getValue() != expected) return false;
+                expected *= ratio;
+            }
+            const APInt &end = cast<ConstantInt>(group.back())->getValue();
+            if (!start.isSignedIntN(64) || !ratio.isSignedIntN(64) || !end.isSignedIntN(64)) return false;
+            info = {start.getSExtValue(), end.getSExtValue(), ratio.getSExtValue(), MonotonicOp::MUL};
+            return true;
+        }
+
+        // Splits V into base + offset by peeling off adds and subs of constants,
+        // and ors of constants that share no bits with the base, which is
+        // what instcombine makes of i + 1 when i is known to be even.
+        static Value *strip_constant_offset(Value *V, int64_t &offset) {
+            offset = 0;
+            for (unsigned steps = 0; steps < MaxGraphDepth; ++steps) {
+                BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+                if (!BO) break;
+                unsigned c = BO->getOpcode() == Instruction::Add && isa<ConstantInt>(BO->getOperand(0)) ? 0 : 1;
+                ConstantInt *C = dyn_cast<ConstantInt>(BO->getOperand(c));
+                if (!C || C->getBitWidth() > 64) break;
+                if (BO->getOpcode() == Instruction::Add) offset += C->getSExtValue();
+                else if (BO->getOpcode() == Instruction::Sub) offset -= C->getSExtValue();
+                else if (BO->getOpcode() == Instruction::Or && !C->isNegative() &&
+                         haveNoCommonBitsSet(BO->getOperand(0), C, BO->getModule()->getDataLayout())) offset += C->getSExtValue();
+                else break;
+                V = BO->getOperand(1 - c);
+            }
+            return V;
+        }
+
+        // Recognises integer groups such as [i, i + 1, i + 2], which is what
+        // -loop-unroll leaves behind for the indices of the copies, as one base
+        // value plus a monotonic sequence of constant offsets.
+        //
+        // Pointer groups made of constant-index GEPs off one pointer, such as
+        // the fields of a struct, are brought to that pointer plus a byte
+        // offset, so fields of one type at a regular stride form a sequence
+        // even though their typed GEPs differ in a struct index.
+        //
+        // Failing that, SCEV may still prove every member a constant distance
+        // from the first one, as for i | 1 with i even, or for pointers p,
+        // p + 1, p + 2 that instcombine makes of unrolled addresses. The
+        // first member is then the base. Groups of instructions that match
+        // each other are left to the graph.
+        bool check_offsets(ArrayRef<Value*> group, Value *&base, MonotonicInfo &info) {
+            Type *ty = group[0]->getType();
+            if (group.size() < 2 || !(ty->isIntegerTy() || ty->isPointerTy())) return false;
+            for (Value *V: group) {
+                if (V->getType() != ty) return false;
+            }
+
+            std::vector<int64_t> offsets(group.size());
+            base = nullptr;
+            for (unsigned k = 0; k < group.size() && ty->isIntegerTy(); ++k) {
+                Value *b = strip_constant_offset(group[k], offsets[k]);
+                if (isa<Constant>(b)) return false;  // constant groups are plain sequences
+                if (base && b != base) {
+                    base = nullptr;
+                    break;
+                }
+                base = b;
+            }
+            if (ty->isPointerTy() && SE && !is_uniform(group)) {
+                MonotonicInfo elements;
+                if (check_elements(group, elements)) return false;  // typed GEPs are cheaper
+                const DataLayout &DL = SE->getDataLayout();
+                for (unsigned k = 0; k < group.size(); ++k) {
+                    APInt offset(DL.getIndexTypeSizeInBits(ty), 0);
+                    Value *b = group[k]->stripAndAccumulateConstantOffsets(DL, offset, true);
+                    if ((base && b != base) || !offset.isSignedIntN(64)) {
+                        base = nullptr;
+                        break;
+                    }
+                    base = b;
+                    offsets[k] = offset.getSExtValue();
+                }
+            }
+            if (!base) {
+                if (!SE || isa<Constant>(group[0]) || is_uniform(group) || check_equivalence(group)) return false;
+                auto lock = lock_context();
+                const SCEV *first = SE->getSCEV(group[0]);
+                for (unsigned k = 0; k < group.size(); ++k) {
+                    const SCEVConstant *d = dyn_cast<SCEVConstant>(SE->getMinusSCEV(SE->getSCEV(group[k]), first));
+                    if (!d || !d->getAPInt().isSignedIntN(64)) return false;
+                    offsets[k] = d->getAPInt().getSExtValue();
+                }
+                base = group[0];
+            }
+
+            int64_t diff = offsets[1] - offsets[0];
+            if (diff == 0) return false;
+            for (unsigned k = 1; k + 1 < offsets.size(); ++k) {
+                if (offsets[k + 1] - offsets[k] != diff) return false;
+            }
+            info = {offsets[0], offsets.back(), diff, MonotonicOp::ADD};
+            return true;
+        }
+
+        // Recognises constant addresses of consecutive elements of one object,
+        // i.e. GEP constant expressions that only differ in a monotonic last
+        // index, which is what stores to a[0], a[1], ... are made of.
+        bool check_elements(ArrayRef<Value*> group, MonotonicInfo &info) {
+            if (group.size() < 2) return false;
+            GEPOperator *first = dyn_cast<GEPOperator>(group[0]);
+            if (!first || !isa<ConstantExpr>(first) || first->getNumIndices() == 0) return false;
+            gep_type_iterator last = gep_type_begin(first);
+            std::advance(last, first->getNumIndices() - 1);
+            if (last.isStruct()) return false;  // field numbers stay constant
+
+            std::vector<Value*> last_indices;
+            for (Value *V: group) {
+                GEPOperator *gep = dyn_cast<GEPOperator>(V);
+                if (!gep || !isa<ConstantExpr>(gep)) return false;
+                if (gep->getSourceElementType() != first->getSourceElementType() ||
+                    gep->getPointerOperand() != first->getPointerOperand() ||
+                    gep->getNumOperands() != first->getNumOperands()) return false;
+                for (unsigned i = 1; i + 1 < gep->getNumOperands(); ++i) {
+                    if (gep->getOperand(i) != first->getOperand(i)) return false;
+                }
+                last_indices.push_back(gep->getOperand(gep->getNumOperands() - 1));
+            }
+            return !is_uniform(last_indices) && check_monotonic(last_indices, info);
+        }
+
+        // Constants can be stored in one table if they all have the same
+        // sized type.
+        static bool same_table_type(ArrayRef<Value*> group) {
+            Type *ty = group[0]->getType();
+            if (!ty->isSized()) return false;
             for (Value *C: group) {
-                ConstantInt *ci = (ConstantInt*) C;
-                int_vals.push_back(ci->getLimitedValue());
+                if (C->getType() != ty) return false;
             }
+            return true;
+        }
+
+        // Whether I and I0 extend integers of different widths to the same
+        // type, which -hw1-widen-casts lets share one group.
+        static bool is_widened_cast(Instruction *I0, Instruction *I) {
+            return WidenCasts && (isa<SExtInst>(I0) || isa<ZExtInst>(I0)) && I->getOpcode() == I0->getOpcode() &&
+                   I->getType() == I0->getType() && I->getOperand(0)->getType() != I0->getOperand(0)->getType();
+        }
 
-            if (int_vals[0] == 0) return false;  // exit, cannot start from 0
-            if (int_vals[1] % int_vals[0] != 0) return false;
-            int64_t diff = int_vals[1] / int_vals[0];
-            if (diff == 1) return false;  // trivial case, not considered multiplication
+        // Brings the sources of a group of widened casts to the widest source
+        // type. Constants are extended in place; any other narrower source
+        // makes the group a mismatch.
+        static bool widen_sources(ArrayRef<Value*> members, std::vector<Value*> &sources) {
+            Type *widest = nullptr;
+            for (Value *V: members) {
+                Type *ty = cast<Instruction>(V)->getOperand(0)->getType();
+                if (!widest || ty->getIntegerBitWidth() > widest->getIntegerBitWidth()) widest = ty;
+            }
+            for (unsigned k = 0; k < members.size(); ++k) {
+                Instruction *I = cast<Instruction>(members[k]);
+                Value *V = I->getOperand(0);
+                if (V->getType() == widest) continue;
+                Constant *C = dyn_cast<Constant>(V);
+                if (!C) return false;
+                sources[k] = ConstantExpr::getCast(I->getOpcode(), C, widest);
+            }
+            return true;
+        }
 
-            for (int k = 1; k < group.size() - 1; ++k) {
-                if (int_vals[k] == 0) return false;  // exit, cannot start from 0
-                if (int_vals[k + 1] % int_vals[k] != 0) return false;
-                if (int_vals[k + 1] / int_vals[k] != diff) return false; 
+        // What the rolled loop cannot merge between members: volatile and
+        // atomic accesses must agree, and so must the attributes of calls,
+        // since dropping e.g. signext or byval would change the ABI.
+        // Alignment, flags and metadata are merged by merge_members.
+        static bool same_special_state(Instruction *a, Instruction *b) {
+            if (LoadInst *L = dyn_cast<LoadInst>(a)) {
+                LoadInst *M = cast<LoadInst>(b);
+                return L->isVolatile() == M->isVolatile() && L->getOrdering() == M->getOrdering() && L->getSyncScopeID() == M->getSyncScopeID();
+            }
+            if (StoreInst *S = dyn_cast<StoreInst>(a)) {
+                StoreInst *T = cast<StoreInst>(b);
+                return S->isVolatile() == T->isVolatile() && S->getOrdering() == T->getOrdering() && S->getSyncScopeID() == T->getSyncScopeID();
+            }
+            if (isa<AtomicRMWInst>(a) || isa<AtomicCmpXchgInst>(a) || isa<FenceInst>(a)) return a->isSameOperationAs(b);
+            if (CallBase *C = dyn_cast<CallBase>(a)) {
+                CallBase *D = cast<CallBase>(b);
+                if (C->hasOperandBundles() || D->hasOperandBundles()) return false;
+                return C->getFunctionType() == D->getFunctionType() && C->getCallingConv() == D->getCallingConv() && C->getAttributes() == D->getAttributes();
             }
             return true;
         }
 
-        bool check_equivalence(std::vector<Value*> &group) {
+        bool check_equivalence(ArrayRef<Value*> group) {
             if (group.empty()) return false;
             if (group.size() < 2) return true;
+            if (is_uniform(group)) return true;  // same value in every member, used as is
 
             bool is_instruction = true;
             bool is_constant = true;
@@ -142,373 +613,1781 @@ namespace{
                 Instruction* I0 = (Instruction*) group[0];
 
                 auto opcode = I0->getOpcode();
-                auto operator_type = I0->getType()->getTypeID();
-                std::vector<Type::TypeID> operand_types(I0->getNumOperands());
-                for (int i = 0; i < I0->getNumOperands(); ++i) operand_types[i] = I0->getOperand(i)->getType()->getTypeID();
+                Type *operator_type = I0->getType();
+                std::vector<Type*> operand_types(I0->getNumOperands());
+                for (int i = 0; i < I0->getNumOperands(); ++i) operand_types[i] = I0->getOperand(i)->getType();
 
                 for (int i = 1; i < group.size(); ++i) {
                     Instruction *I = (Instruction*) group[i];
                     if (I->getOpcode() != opcode) return false;
-                    if (I->getType()->getTypeID() != operator_type) return false;
+                    if (CmpInst *C = dyn_cast<CmpInst>(I)) {
+                        CmpInst::Predicate pred = cast<CmpInst>(I0)->getPredicate();
+                        if (C->getPredicate() != pred && !(ReorderOperands && C->getSwappedPredicate() == pred)) return false;
+                    }
+                    if (I->getType() != operator_type) return false;
+                    if (I->getNumOperands() != operand_types.size()) return false;
+                    if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(I)) {
+                        if (GEP->getSourceElementType() != cast<GetElementPtrInst>(I0)->getSourceElementType()) return false;
+                    }
+                    if (!same_special_state(I0, I)) return false;
+                    if (is_widened_cast(I0, I)) continue;
                     for (int j = 0; j < I0->getNumOperands(); ++j) {
-                        if (I->getOperand(j)->getType()->getTypeID() != operand_types[j]) return false;
+                        if (I->getOperand(j)->getType() != operand_types[j]) return false;
                     }
                 }
                 return true;
             } else if (is_constant) {
-                if (isa<ConstantInt>(group[0])) {
-                    if (check_monotonic(group)) return true;
-                    if (check_monotonic_mul(group)) return true;
-                }
+                MonotonicInfo info;
+                if (check_monotonic(group, info) || check_monotonic_mul(group, info)) return true;
 
                 Value* val = group[0];
                 for (Value* C: group) {
-                    if (C != val) return false;
+                    if (C != val) return ConstantTables && same_table_type(group);
                 }
 
                 return true;
-                // if (isa<ConstantInt>(group[0])) {
-                //     APInt int_val = (static_cast<ConstantInt *>(group[0]))->getValue();
-                //     for (auto C: group) {
-                //         ConstantInt* ci = static_cast<ConstantInt *>(C);
-                //         if (ci->getValue() != int_val) return false;
-                //     }
-                //     return true;
-                // } else if (isa<Function>(group[0])) {
-                // }
-                // return false;  // TODO
             } else {
                 // errs() << *group[0] << "\n";
                 return false;
             }
         }
 
-        Node create_alignment_graph(std::vector<Value*> &group) {
-            Node n = Node();
-            n.values = group;
-            n.is_match = true;
-            n.flag = NodeFlag::NONE;
+        // How well a and b would align as one group, looking through up to
+        // depth levels of operands. Used to pick operand orders only.
+        static unsigned operand_score(Value *a, Value *b, unsigned depth) {
+            if (a == b) return 4;
+            if (a->getType() != b->getType()) return 0;
+            if (isa<Constant>(a) && isa<Constant>(b)) return 2;
+            int64_t offsetA, offsetB;
+            if (strip_constant_offset(a, offsetA) == strip_constant_offset(b, offsetB) && offsetA != offsetB) return 3;
+            Instruction *IA = dyn_cast<Instruction>(a);
+            Instruction *IB = dyn_cast<Instruction>(b);
+            if (!IA || !IB || IA->getOpcode() != IB->getOpcode() || IA->getNumOperands() != IB->getNumOperands()) return 0;
+            unsigned score = 2;
+            if (depth > 0) {
+                for (unsigned i = 0; i < IA->getNumOperands(); ++i) score += operand_score(IA->getOperand(i), IB->getOperand(i), depth - 1);
+            }
+            return score;
+        }
+
+        // Decides, for each member of a group of commutative binary operators
+        // or compares, whether its two operands are read swapped, so that
+        // they line up with those of the first member. A compare whose
+        // predicate is the swap of the first one's must be read swapped.
+        static void reorder_operands(ArrayRef<Value*> members, std::vector<bool> &swapped) {
+            swapped.assign(members.size(), false);
+            Instruction *I0 = cast<Instruction>(members[0]);
+            CmpInst *C0 = dyn_cast<CmpInst>(I0);
+            if (!ReorderOperands || I0->getNumOperands() != 2 || !(I0->isCommutative() || C0)) return;
+
+            for (unsigned k = 1; k < members.size(); ++k) {
+                Instruction *I = cast<Instruction>(members[k]);
+                if (C0 && cast<CmpInst>(I)->getPredicate() != C0->getPredicate()) {
+                    swapped[k] = true;
+                    continue;
+                }
+                if (C0 && !C0->isEquality()) continue;
+                unsigned straight = operand_score(I0->getOperand(0), I->getOperand(0), 2) + operand_score(I0->getOperand(1), I->getOperand(1), 2);
+                unsigned crossed = operand_score(I0->getOperand(0), I->getOperand(1), 2) + operand_score(I0->getOperand(1), I->getOperand(0), 2);
+                swapped[k] = crossed > straight;
+            }
+        }
+
+        NodeId add_group_node(AlignmentGraph &graph, ArrayRef<Value*> group, bool is_match) {
+            NodeId id = graph.add_node(group, is_match);
+            if (HashConsGraph) graph.intern(id);
 
             if (isa<Instruction>(group[0])) {
-                n.type = NodeType::INSTRUCTION;
-
-                // errs () << *((Instruction*) group[0]) << "\n";
-                for (int i = 0; i < ((Instruction*) group[0])->getNumOperands(); ++i) {
-                    std::vector<Value*> operandGroup;
-                    for (auto& I: group) {
-                        // errs() << ((Instruction*) I)->getNumOperands() << "\n";
-                        auto use = ((Instruction*) I)->getOperandUse(i).get();
-                        operandGroup.push_back(use);
+                graph.nodes[id].type = NodeType::INSTRUCTION;
+            } else if (isa<Constant>(group[0])) {
+                graph.nodes[id].type = NodeType::CONSTANT;
+            } else {
+                graph.nodes[id].type = NodeType::OTHER;
+            }
+            return id;
+        }
+
+        // Builds the graph breadth first from a worklist. Operand groups of a
+        // node are allocated next to each other, so later walks touch the
+        // arena mostly sequentially. Instruction groups deeper than
+        // -hw1-max-depth are left unexpanded and treated as mismatches.
+        NodeId create_alignment_graph(AlignmentGraph &graph, ArrayRef<Value*> group) {
+            NodeId root;
+            if (HashConsGraph && graph.lookup(group, root)) return root;
+            // the seeds themselves must agree like any other group, down to
+            // their number of operands and the state of volatile accesses
+            root = add_group_node(graph, group, check_equivalence(group));
+            if (!graph.nodes[root].is_match) return root;
+
+            std::vector<std::pair<NodeId, unsigned>> worklist = {{root, 0}};
+            std::vector<Value*> members;
+            std::vector<Value*> operandGroup;
+            std::vector<bool> swapped;
+            for (size_t head = 0; head < worklist.size(); ++head) {
+                NodeId id = worklist[head].first;
+                unsigned depth = worklist[head].second;
+                if (graph.nodes[id].type != NodeType::INSTRUCTION) continue;
+                if (graph.nodes[id].flag != NodeFlag::NONE) continue;
+                if (id != root && is_uniform(graph.values(id))) continue;  // leaf, never cloned
+                if (depth >= MaxGraphDepth) {
+                    graph.nodes[id].is_match = false;
+                    continue;
+                }
+
+                ArrayRef<Value*> values = graph.values(id);
+                members.assign(values.begin(), values.end());
+                operandGroup.resize(members.size());
+
+                unsigned num_operands = ((Instruction*) members[0])->getNumOperands();
+                reorder_operands(members, swapped);
+                graph.reserve_edges(id, num_operands);
+                for (unsigned i = 0; i < num_operands; ++i) {
+                    for (unsigned k = 0; k < members.size(); ++k) {
+                        operandGroup[k] = ((Instruction*) members[k])->getOperandUse(swapped[k] ? 1 - i : i).get();
+                    }
+                    // members only disagree on operand types when they are
+                    // widened casts
+                    if (!all_of(operandGroup, [&](Value *V) { return V->getType() == operandGroup[0]->getType(); })) {
+                        bool widened = isa<SExtInst>(members[0]) || isa<ZExtInst>(members[0]);
+                        auto lock = lock_context();
+                        if (!widened || !widen_sources(members, operandGroup)) graph.nodes[id].is_match = false;
                     }
-                    if (check_equivalence(operandGroup)) {
-                        Node e = create_alignment_graph(operandGroup);
-                        n.edges.push_back(e);
+
+                    NodeId e;
+                    Value *base;
+                    MonotonicInfo offsets;
+                    if (HashConsGraph && graph.lookup(operandGroup, e)) {
+                        // shared with another seed
+                    } else if (check_offsets(operandGroup, base, offsets)) {
+                        e = add_group_node(graph, operandGroup, true);
+                        graph.nodes[e].flag = NodeFlag::MONOTONIC_OFFSETS;
+                        graph.nodes[e].monotonicInfo = offsets;
+                        graph.nodes[e].offset_base = base;
+                    } else if (check_elements(operandGroup, offsets)) {
+                        e = add_group_node(graph, operandGroup, true);
+                        graph.nodes[e].flag = NodeFlag::MONOTONIC_ELEMENTS;
+                        graph.nodes[e].monotonicInfo = offsets;
                     } else {
-                        Node e = Node();
-                        e.is_match = false;
-                        n.edges.push_back(e);
+                        bool is_match = check_equivalence(operandGroup);
+                        e = add_group_node(graph, operandGroup, is_match);
+                        if (is_match) worklist.push_back({e, depth + 1});
                     }
+                    graph.edge_pool[graph.nodes[id].edge_begin + i] = e;
                 }
-            } else if (isa<Constant>(group[0])) {
-                n.type = NodeType::CONSTANT;
-            } else {
-                n.type = NodeType::OTHER;
             }
 
-            return n;
+            return root;
         }
 
-        Node insert_monotonic_info(Node n) {
-            if (n.type == NodeType::CONSTANT && isa<ConstantInt>(n.values[0])) {
-                if (n.values.size() >= 2) {
-                    if (check_monotonic(n.values)) {
-                        n.flag = NodeFlag::MONOTONIC_CONSTANTS;
-                        std::vector<int64_t> int_vals;
-                        for (Value *C: n.values) {
-                            ConstantInt *ci = (ConstantInt*) C;
-                            int_vals.push_back(ci->getLimitedValue());
-                        }
-                        int64_t diff = int_vals[1] - int_vals[0];
-                        n.monotonicInfo = {int_vals[0], int_vals[int_vals.size() - 1], diff, MonotonicOp::ADD};
-                    } else if (check_monotonic_mul(n.values)) {
+        void insert_monotonic_info(AlignmentGraph &graph, NodeId root) {
+            walk_graph(graph, root, [&](NodeId id, unsigned) {
+                Node &n = graph.nodes[id];
+                if (n.annotated) return false;  // shared group, already visited from another seed
+                n.annotated = true;
+
+                ArrayRef<Value*> values = graph.values(id);
+                if (n.is_match && n.type == NodeType::CONSTANT && isa<ConstantInt>(values[0])) {
+                    if (check_monotonic(values, n.monotonicInfo) || check_monotonic_mul(values, n.monotonicInfo)) {
                         n.flag = NodeFlag::MONOTONIC_CONSTANTS;
-                        std::vector<int64_t> int_vals;
-                        for (Value *C: n.values) {
-                            ConstantInt *ci = (ConstantInt*) C;
-                            int_vals.push_back(ci->getLimitedValue());
-                        }
-                        int64_t diff = int_vals[1] / int_vals[0];
-                        n.monotonicInfo = {int_vals[0], int_vals[int_vals.size() - 1], diff, MonotonicOp::MUL};
                     }
                 }
-            }
-
-            for (int i = 0; i < n.edges.size(); ++i) {
-                n.edges[i] = insert_monotonic_info(n.edges[i]);
-            }
-
-            return n;
+                if (n.is_match && n.type == NodeType::CONSTANT && n.flag == NodeFlag::NONE && !is_uniform(values)) {
+                    n.flag = NodeFlag::CONSTANT_TABLE;
+                }
+                return true;
+            });
         }
 
-        void print_graph(Node n, int level) {
-            if (!n.is_match) {
-                 errs() << "level: " << level << ", mismatch\n";
-            } else {
-                errs() << "START GROUP\n";
+        // Dumps the alignment graph of one seed group for -hw1-print-graph.
+        void print_graph(const AlignmentGraph &graph, NodeId root) {
+            walk_graph(graph, root, [&](NodeId id, unsigned level) {
+                const Node &n = graph.nodes[id];
+                if (!n.is_match) {
+                     *Log << "level: " << level << ", mismatch\n";
+                     return false;
+                }
+                *Log << "START GROUP\n";
+                if (n.flag == NodeFlag::MONOTONIC_OFFSETS) {
+                    *Log << "[OFFSET SEQUENCE] base: " << *n.offset_base << " ";
+                    *Log << "start: " << n.monotonicInfo.start << " end: " << n.monotonicInfo.end << " increment: " << n.monotonicInfo.increment << "\n";
+                }
+                if (n.flag == NodeFlag::MONOTONIC_ELEMENTS) {
+                    *Log << "[ELEMENT SEQUENCE] " << *graph.values(id)[0] << " ";
+                    *Log << "start: " << n.monotonicInfo.start << " end: " << n.monotonicInfo.end << " increment: " << n.monotonicInfo.increment << "\n";
+                }
+                if (n.flag == NodeFlag::CONSTANT_TABLE) {
+                    *Log << "[CONSTANT TABLE] size: " << graph.nodes[id].num_values << "\n";
+                }
                 if (n.flag == NodeFlag::MONOTONIC_CONSTANTS) {
-                    if (n.monotonicInfo.monotonic_op == MonotonicOp::ADD) errs () << "[ADD SEQUENCE] ";
-                    if (n.monotonicInfo.monotonic_op == MonotonicOp::MUL) errs () << "[MUL SEQUENCE] ";
-                    errs() << "start: " << n.monotonicInfo.start << " end: " << n.monotonicInfo.end << " increment: " << n.monotonicInfo.increment << "\n";
+                    if (n.monotonicInfo.monotonic_op == MonotonicOp::ADD) *Log << "[ADD SEQUENCE] ";
+                    if (n.monotonicInfo.monotonic_op == MonotonicOp::MUL) *Log << "[MUL SEQUENCE] ";
+                    *Log << "start: " << n.monotonicInfo.start << " end: " << n.monotonicInfo.end << " increment: " << n.monotonicInfo.increment << "\n";
                 }
 
-                for (auto &val: n.values) {
-                    errs() << "level: " << level << ", match" << ", val:" << *val << "\n";
-                }
-                errs() << "END GROUP\n\n";
-                for (auto edge: n.edges) {
-                    print_graph(edge, level + 1);
+                for (Value *val: graph.values(id)) {
+                    *Log << "level: " << level << ", match" << ", val:" << *val << "\n";
                 }
-            }
+                *Log << "END GROUP\n\n";
+                return true;
+            });
         }
 
-        bool canRoll(Node &node) {
-            if (node.flag == NodeFlag::MONOTONIC_CONSTANTS && node.monotonicInfo.start != node.monotonicInfo.end) {
-                return true;
+        // Whether operand i of I may be replaced by a value computed in the
+        // loop. Struct indices, immediate intrinsic arguments and callees
+        // have to stay constant.
+        static bool operand_may_vary(Instruction *I, unsigned i) {
+            if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(I)) {
+                if (i == 0) return true;
+                gep_type_iterator GTI = gep_type_begin(GEP);
+                std::advance(GTI, i - 1);
+                return !GTI.isStruct();
             }
-            for (auto edge: node.edges) {
-                if (canRoll(edge)) {
-                    return true;
-                }
+            if (CallBase *CB = dyn_cast<CallBase>(I)) {
+                if (CB->isCallee(&CB->getOperandUse(i)) || CB->isInlineAsm()) return false;
+                if (i < CB->arg_size() && CB->paramHasAttr(i, Attribute::ImmArg)) return false;
+                return true;
             }
+            return !isa<ShuffleVectorInst>(I) && !isa<AllocaInst>(I);
+        }
+
+        // Whether a call group may load its callees from a table, under
+        // -hw1-indirect-calls: direct calls of one signature and the same
+        // call site attributes, to functions that may be called indirectly.
+        static bool is_callee_table(const AlignmentGraph &graph, NodeId call, unsigned i) {
+            ArrayRef<Value*> members = graph.values(call);
+            CallInst *C0 = dyn_cast<CallInst>(members[0]);
+            if (!IndirectCalls || !C0 || !C0->isCallee(&C0->getOperandUse(i))) return false;
+            if (graph.nodes[graph.edge(call, i)].flag != NodeFlag::CONSTANT_TABLE) return false;
+            return all_of(members, [&](Value *V) {
+                CallInst *CI = cast<CallInst>(V);
+                Function *callee = CI->getCalledFunction();
+                return callee && !callee->isIntrinsic() && !CI->isMustTailCall() && !CI->hasOperandBundles() &&
+                       CI->getAttributes() == C0->getAttributes();
+            });
+        }
+
+        static bool reject(RollPlan &plan, const char *reason) {
+            plan.reason = reason;
             return false;
         }
 
-        void dfsGraph(Node &curNode, int level, std::vector<int>& maxDepth,  std::vector<Value*> &values, std::vector<int64_t>& mono, std::vector<MonotonicOp>& monoOp) {
-            if (level > maxDepth[0] && maxDepth[0] >= 0) {
-                maxDepth[0] = level;
-            } 
+        // Walks the graph of a seed group and sorts its nodes into plan.body
+        // (matched instruction groups of one block, whose members end up in
+        // tree) and plan.sequences (values derived from the member index).
+        // Values shared by all members are collected in leaves.
+        bool collect_group(const AlignmentGraph &graph, NodeId root, RollPlan &plan,
+                           SmallPtrSetImpl<Instruction*> &tree, SmallPtrSetImpl<Value*> &leaves, bool &varies) {
+            BasicBlock *BB = cast<Instruction>(graph.values(root)[0])->getParent();
+            const char *why = nullptr;
+            DenseSet<NodeId> visited;
+            walk_graph(graph, root, [&](NodeId id, unsigned) {
+                if (why || !visited.insert(id).second) return false;
+                const Node &n = graph.nodes[id];
+                ArrayRef<Value*> values = graph.values(id);
+                if (id != root && is_uniform(values)) {
+                    leaves.insert(values[0]);
+                    return false;
+                }
+                if (!n.is_match) {
+                    why = "operands do not align";
+                    return false;
+                }
+                if (n.flag != NodeFlag::NONE) {
+                    // every sequence has one element per member, so they can all
+                    // be derived from the same induction variable
+                    if (n.flag == NodeFlag::MONOTONIC_OFFSETS) leaves.insert(n.offset_base);
+                    if (n.flag == NodeFlag::CONSTANT_TABLE || n.monotonicInfo.start != n.monotonicInfo.end) varies = true;
+                    plan.sequences.push_back(id);
+                    return false;
+                }
+                if (n.type != NodeType::INSTRUCTION) {
+                    why = "operands do not align";
+                    return false;
+                }
+                for (Value *V: values) {
+                    Instruction *I = cast<Instruction>(V);
+                    if (I->getParent() != BB || isa<PHINode>(I) || isa<AllocaInst>(I) ||
+                        I->isTerminator() || I->isEHPad()) {
+                        why = "instruction cannot be moved into a loop";
+                        return false;
+                    }
+                    tree.insert(I);
+                }
+                plan.body.push_back(id);
+                return true;
+            });
+            if (why) return reject(plan, why);
+            return true;
+        }
 
-            if (curNode.flag == NodeFlag::MONOTONIC_CONSTANTS && curNode.monotonicInfo.start != curNode.monotonicInfo.end) {
-                mono.push_back(curNode.monotonicInfo.start);
-                mono.push_back(curNode.monotonicInfo.end);
-                mono.push_back(curNode.monotonicInfo.increment);
-                monoOp.push_back(curNode.monotonicInfo.monotonic_op);
+        // Records the instructions the loop replaces: the group and the
+        // offsets from a base that only the group uses, which the loop
+        // derives from the base. The first member's offset is one of them
+        // unless it is the base itself.
+        static void set_erase(const AlignmentGraph &graph, RollPlan &plan, const SmallPtrSet<Instruction*, 32> &tree) {
+            plan.erase = tree;
+            plan.dead.clear();
+            for (NodeId id: plan.sequences) {
+                if (graph.nodes[id].flag != NodeFlag::MONOTONIC_OFFSETS) continue;
+                for (Value *V: graph.values(id)) {
+                    if (V == graph.nodes[id].offset_base) continue;
+                    Instruction *I = dyn_cast<Instruction>(V);
+                    if (!I || I->mayHaveSideEffects() || plan.dead.count(I)) continue;
+                    if (all_of(I->users(), [&](User *U) { return plan.erase.count(dyn_cast<Instruction>(U)); })) plan.dead.insert(I);
+                }
+            }
+        }
+
+        // Checks that a seed group can be rolled and records how. Every node
+        // reachable from the root must either be the same value in all members
+        // (used as is), a monotonic constant sequence (replaced by an induction
+        // expression), or a matched instruction group whose members are only
+        // used inside the group (cloned once into the loop body).
+        bool canRoll(const AlignmentGraph &graph, NodeId root, RollPlan &plan) {
+            ArrayRef<Value*> roots = graph.values(root);
+            plan = RollPlan();
+            plan.root = root;
+            if (roots.size() < 2) return reject(plan, "single member");
+            if (!graph.nodes[root].is_match) return reject(plan, "members differ");
+
+            plan.trip_count = roots.size();
+            plan.unroll = 1;
+
+            bool varies = false;
+            SmallPtrSet<Instruction*, 32> tree;
+            SmallPtrSet<Value*, 16> leaves;
+            if (!collect_group(graph, root, plan, tree, leaves, varies)) return false;
+            if (!varies) return reject(plan, "nothing varies between members");
+
+            // constants that become loop variant must sit in operands that
+            // accept a variable
+            for (NodeId id: plan.body) {
+                Instruction *I = cast<Instruction>(graph.values(id)[0]);
+                for (unsigned i = 0; i < graph.nodes[id].num_edges; ++i) {
+                    const Node &e = graph.nodes[graph.edge(id, i)];
+                    if (e.flag == NodeFlag::NONE) continue;
+                    if (is_callee_table(graph, id, i)) {
+                        plan.indirect = true;
+                        continue;
+                    }
+                    if (!operand_may_vary(I, i)) return reject(plan, "varying constant in an operand that must stay constant");
+                }
             }
 
-            
+            // the original instructions are erased, so nothing outside the
+            // group may use them, and no leaf may be one of them
+            for (Instruction *I: tree) {
+                for (User *U: I->users()) {
+                    if (!tree.count(dyn_cast<Instruction>(U))) return reject(plan, "result used outside the group");
+                }
+            }
+            for (Value *V: leaves) {
+                if (isa<Instruction>(V) && tree.count(cast<Instruction>(V))) return reject(plan, "shared value computed inside the group");
+            }
 
-            for (auto node : curNode.edges) {
-                dfsGraph(node, level + 1, maxDepth, values, mono, monoOp);
+            // clone in the order of the first member; memory accesses of the
+            // other members must appear in the same order and must not start
+            // before the previous member is done
+            std::sort(plan.body.begin(), plan.body.end(), [&](NodeId a, NodeId b) {
+                return position[cast<Instruction>(graph.values(a)[0])] < position[cast<Instruction>(graph.values(b)[0])];
+            });
+            for (unsigned k = 0; k < roots.size(); ++k) {
+                unsigned prev = 0;
+                for (NodeId id: plan.body) {
+                    Instruction *I = cast<Instruction>(graph.values(id)[k]);
+                    if (!I->mayReadOrWriteMemory()) continue;
+                    if (position[I] < prev) return reject(plan, "memory accesses would be reordered");
+                    if (k > 0 && position[I] < position[cast<Instruction>(roots[k - 1])]) return reject(plan, "memory accesses would be reordered");
+                    prev = position[I];
+                }
             }
 
-            if (maxDepth[0] >= 0 && level == maxDepth[0] -1) {
-                values.push_back(curNode.values[0]);
-                maxDepth[0] = -1;
+            plan.first = nullptr;
+            for (Instruction *I: tree) {
+                if (!plan.first || position[I] < position[plan.first]) plan.first = I;
             }
+            plan.last = cast<Instruction>(roots.back());
 
-            if (level == 3 || level == 1) {
-                values.push_back(curNode.values[0]);
+            // instructions interleaved with the group stay where they are while
+            // the group moves into the loop, so they must not touch memory
+            for (Instruction *I = plan.first; I != plan.last; I = I->getNextNode()) {
+                if (tree.count(I) || isa<DbgInfoIntrinsic>(I)) continue;
+                if (I->mayHaveSideEffects() || I->mayReadFromMemory()) return reject(plan, "interleaved instruction touches memory");
             }
-            
+
+            set_erase(graph, plan, tree);
+            return true;
         }
 
-        void eraseDfs(int level, Node& node) {
+        // Keeps unroll copies of the group per iteration. Members that do not
+        // fill a whole iteration stay behind the loop as they are, so the
+        // checks that depend on which instructions are erased are redone
+        // for the members that are rolled.
+        bool set_unroll(const AlignmentGraph &graph, RollPlan &plan, unsigned unroll) {
+            ArrayRef<Value*> roots = graph.values(plan.root);
+            plan.unroll = unroll;
+            plan.trip_count = roots.size() / unroll;
+            if (plan.trip_count < 2) return reject(plan, "too few members for the unroll factor");
+            unsigned members = plan.trip_count * unroll;
+            if (members == roots.size()) return true;
+
+            SmallPtrSet<Instruction*, 32> tree;
+            for (NodeId id: plan.body) {
+                ArrayRef<Value*> values = graph.values(id);
+                for (unsigned k = 0; k < members; ++k) tree.insert(cast<Instruction>(values[k]));
+            }
+            for (Instruction *I: tree) {
+                for (User *U: I->users()) {
+                    if (!tree.count(dyn_cast<Instruction>(U))) return reject(plan, "result used by the remainder");
+                }
+            }
+            plan.last = cast<Instruction>(roots[members - 1]);
+            for (Instruction *I = plan.first; I != plan.last; I = I->getNextNode()) {
+                if (tree.count(I) || isa<DbgInfoIntrinsic>(I)) continue;
+                if (I->mayHaveSideEffects() || I->mayReadFromMemory()) return reject(plan, "remainder touches memory inside the loop range");
+            }
+            set_erase(graph, plan, tree);
+            return true;
+        }
 
-            for (auto val : node.values) {
-                dyn_cast<Instruction>(val)->eraseFromParent();
+        // Terms of the induction variable shared by the sequences of one
+        // copy of the loop body: the induction variable converted to each
+        // type, and its multiples. Calls whose arguments follow several
+        // sequences compute each term once; is_profitable only uses the keys.
+        struct SharedTerms {
+            DenseMap<Type*, Value*> casts;
+            DenseMap<std::pair<Type*, int64_t>, Value*> scaled;
+        };
+
+        // TTI cost of iv * increment in type ty, unless another sequence of
+        // the copy already needs it.
+        InstructionCost term_cost(SharedTerms &terms, Type *ty, Type *ivTy, int64_t increment, TargetTransformInfo::TargetCostKind kind) {
+            if (!terms.scaled.insert({{ty, increment}, nullptr}).second) return 0;
+            InstructionCost cost = 0;
+            if (ty != ivTy && terms.casts.insert({ty, nullptr}).second) {
+                cost += TTI->getCastInstrCost(ty->getIntegerBitWidth() < ivTy->getIntegerBitWidth() ? Instruction::Trunc : Instruction::SExt,
+                                              ty, ivTy, TargetTransformInfo::CastContextHint::None, kind);
             }
+            if (increment == -1) cost += TTI->getArithmeticInstrCost(Instruction::Sub, ty, kind);
+            else if (increment != 1) cost += TTI->getArithmeticInstrCost(Instruction::Mul, ty, kind);
+            return cost;
+        }
 
-            if (level != 3) {
-                eraseDfs(level + 1, node.edges[0]);
+        // TTI cost of the instructions that derive a loop-variant operand
+        // from the induction variable in every iteration.
+        InstructionCost sequence_cost(const AlignmentGraph &graph, NodeId id, Type *ivTy, SharedTerms &terms,
+                                      TargetTransformInfo::TargetCostKind kind) {
+            const Node &n = graph.nodes[id];
+            Value *V0 = graph.values(id)[0];
+            Type *ty = V0->getType();
+            if (n.flag == NodeFlag::MONOTONIC_OFFSETS) ty = SE->getEffectiveSCEVType(ty);  // byte offsets of pointers
+            if (n.flag == NodeFlag::MONOTONIC_ELEMENTS) ty = cast<User>(V0)->getOperand(cast<User>(V0)->getNumOperands() - 1)->getType();
+            InstructionCost cost = 0;
+            switch (n.flag) {
+            case NodeFlag::CONSTANT_TABLE:
+                cost += TTI->getArithmeticInstrCost(Instruction::Add, ivTy, kind);
+                cost += TTI->getMemoryOpCost(Instruction::Load, ty, Align(1), 0, kind);
+                break;
+            default:
+                if (n.monotonicInfo.monotonic_op == MonotonicOp::MUL) {
+                    cost += TTI->getCFInstrCost(Instruction::PHI, kind);
+                    cost += TTI->getArithmeticInstrCost(Instruction::Mul, ty, kind);
+                    break;
+                }
+                cost += term_cost(terms, ty, ivTy, n.monotonicInfo.increment, kind);
+                if (n.monotonicInfo.start != 0) cost += TTI->getArithmeticInstrCost(Instruction::Add, ty, kind);
+                if (n.flag != NodeFlag::MONOTONIC_CONSTANTS) cost += TTI->getArithmeticInstrCost(Instruction::Add, ty, kind);
+                break;
             }
+            return cost;
         }
-        
-        void erasePrevInstructions(Node &graph) {
-            eraseDfs(0, graph);
+
+        // TTI cost of the rolled loop's control: induction phi, increment,
+        // compare and branch.
+        InstructionCost loop_cost(Type *ivTy, TargetTransformInfo::TargetCostKind kind) {
+            LLVMContext &context = ivTy->getContext();
+            return TTI->getCFInstrCost(Instruction::PHI, kind) +
+                   TTI->getArithmeticInstrCost(Instruction::Add, ivTy, kind) +
+                   TTI->getCmpSelInstrCost(Instruction::ICmp, ivTy, Type::getInt1Ty(context), CmpInst::ICMP_ULT, kind) +
+                   TTI->getCFInstrCost(Instruction::Br, kind);
         }
 
-        void generateLoop(Function &F, Node &graph) {
+        // The narrowest legal integer type that counts to the end of the loop,
+        // which must stay in the signed range because sequences sign-extend
+        // it. When every sequence that reads it has one wider integer type,
+        // that type is taken instead, so none of them needs a cast.
+        Type *iv_type(const AlignmentGraph &graph, const RollPlan &plan) {
+            LLVMContext &context = plan.last->getContext();
+            const DataLayout &DL = plan.last->getModule()->getDataLayout();
+            unsigned bits = Log2_64((uint64_t) plan.trip_count * plan.unroll) + 2;
+            Type *ty = DL.getSmallestLegalIntType(context, bits);
+            if (!ty) ty = Type::getInt64Ty(context);
+
+            Type *shared = nullptr;
+            for (NodeId id: plan.sequences) {
+                const Node &n = graph.nodes[id];
+                Value *V0 = graph.values(id)[0];
+                if (n.flag == NodeFlag::CONSTANT_TABLE || n.monotonicInfo.monotonic_op == MonotonicOp::MUL) continue;
+                Type *seqTy = n.flag == NodeFlag::MONOTONIC_ELEMENTS ? cast<User>(V0)->getOperand(cast<User>(V0)->getNumOperands() - 1)->getType()
+                                                                     : V0->getType();
+                if (n.flag == NodeFlag::MONOTONIC_OFFSETS) seqTy = SE->getEffectiveSCEVType(seqTy);
+                if (shared && shared != seqTy) return ty;
+                shared = seqTy;
+            }
+            if (!shared || shared->getIntegerBitWidth() < bits) return ty;
+            if (!DL.isLegalInteger(shared->getIntegerBitWidth()) && DL.getLargestLegalIntTypeSizeInBits()) return ty;
+            return shared;
+        }
 
-            LLVMContext* context = &F.getContext();
-            IRBuilder<> builder(*context);
-            Instruction* firstInstr = dyn_cast<Instruction>(graph.values[0]);
-            BasicBlock* first = firstInstr->getParent();
-            std::vector<int64_t> mono;
-            std::vector<Value*> values; // [basePtr, ]
-            std::vector<int> maxDepth = {0};
-            std::vector<MonotonicOp> monoOp;
+        // The indirect calls of a loop over a function table pay for
+        // themselves when the I-cache misses the smaller code saves, once per
+        // function entry, outweigh the extra branch cost of every call the
+        // block makes per entry. Without a profile the block is taken to run
+        // once per entry, which is what long init sequences do.
+        bool indirect_pays_off(const RollPlan &plan) const {
+            BasicBlock *BB = plan.first->getParent();
+            Function *F = BB->getParent();
+            double executions = 1.0;
+            if (BFI && F->hasProfileData()) {
+                uint64_t entry = BFI->getBlockFreq(&F->getEntryBlock()).getFrequency();
+                if (entry) executions = (double) BFI->getBlockFreq(BB).getFrequency() / entry;
+            }
+            double calls = (double) plan.trip_count * plan.unroll;
+            return executions * calls * IndirectCallPenalty <= (plan.size[0] - plan.size[1]) * ICacheUnitCost;
+        }
 
-            dfsGraph(graph, 0, maxDepth, values, mono, monoOp);
+        // Compares the group as it is against the loop generateLoop would
+        // emit for it, on TTI code size and on latency. The group is rolled
+        // only if it shrinks by at least -hw1-min-size-gain and its latency
+        // does not grow by more than -hw1-max-latency-increase percent.
+        bool is_profitable(const AlignmentGraph &graph, RollPlan &plan) {
+            plan.iv_type = iv_type(graph, plan);
+            if (!TTI) return true;
+            const TargetTransformInfo::TargetCostKind kinds[2] = {
+                TargetTransformInfo::TCK_CodeSize, TargetTransformInfo::TCK_Latency };
+            int64_t *results[2] = { plan.size, plan.latency };
+
+            for (unsigned c = 0; c < 2; ++c) {
+                InstructionCost unrolled = 0;
+                for (Instruction *I: plan.erase) unrolled += TTI->getInstructionCost(I, kinds[c]);
+                for (Instruction *I: plan.dead) unrolled += TTI->getInstructionCost(I, kinds[c]);
+
+                InstructionCost copy = 0;
+                for (NodeId id: plan.body) copy += TTI->getInstructionCost(cast<Instruction>(graph.values(id)[0]), kinds[c]);
+                SharedTerms terms;
+                for (NodeId id: plan.sequences) copy += sequence_cost(graph, id, plan.iv_type, terms, kinds[c]);
+                InstructionCost iteration = loop_cost(plan.iv_type, kinds[c]) + copy * plan.unroll;
+
+                InstructionCost rolled = iteration;
+                if (kinds[c] == TargetTransformInfo::TCK_Latency) rolled *= plan.trip_count;
+                if (!unrolled.isValid() || !rolled.isValid()) return reject(plan, "no valid TTI cost");
+                results[c][0] = *unrolled.getValue();
+                results[c][1] = *rolled.getValue();
+            }
 
-            BasicBlock* preHeader = SplitBlock(firstInstr->getParent(), firstInstr);
-            BasicBlock* loopBody = SplitBlock(firstInstr->getParent(), firstInstr);
-            BasicBlock* endLoop = SplitBlock(firstInstr->getParent(), firstInstr);
-            BasicBlock* last = SplitBlock(firstInstr->getParent(), firstInstr);
+            if (plan.indirect) {
+                // the TTI latency of a call does not depend on how its target
+                // is predicted; charge every call through the table
+                plan.latency[1] += (int64_t) (IndirectCallPenalty * plan.trip_count * plan.unroll);
+            }
 
-            builder.SetInsertPoint(preHeader->getTerminator());
-            Value* stepVal = ConstantInt::get(*context, APInt(64, mono[0]));
-            AllocaInst* stepAlloca = builder.CreateAlloca(stepVal->getType(), stepVal);
-            LoadInst* stepVar = builder.CreateLoad(Type::getInt64Ty(*context), stepAlloca, "stepVar");
+            if (plan.size[1] + MinSizeGain > plan.size[0]) return reject(plan, "loop is not smaller than the group");
+            if (plan.indirect && !indirect_pays_off(plan)) return reject(plan, "indirect calls cost more than the code they save");
+            if (MaxLatencyIncrease >= 0 && plan.latency[1] * 100 > plan.latency[0] * (100 + MaxLatencyIncrease)) {
+                return reject(plan, "loop is too slow");
+            }
+            return true;
+        }
 
-            builder.SetInsertPoint(loopBody->getTerminator());
-            PHINode* phi = builder.CreatePHI(stepVar->getType(), 2, "i");
-            phi->addIncoming(stepVar, preHeader);
-            GetElementPtrInst* elemPtr = dyn_cast<GetElementPtrInst>(dyn_cast<Instruction>(values[1])->clone());
-            elemPtr->setOperand(2, phi);
-            elemPtr->insertBefore(loopBody->getTerminator());
-            LoadInst* elemVal = builder.CreateLoad(Type::getInt8Ty(*context), elemPtr, "elemVal");
-            errs() << *values[2] << '\n';
-            SExtInst* seVal = dyn_cast<SExtInst>(dyn_cast<Instruction>(values[2])->clone());
-            errs() << *seVal << '\n';
-            seVal->setOperand(0, elemVal);
-            seVal->insertBefore(loopBody->getTerminator());
-            CallInst* call = dyn_cast<CallInst>(firstInstr->clone());
-            call->setOperand(0, seVal);
-            call->insertBefore(loopBody->getTerminator());
+        void log_decision(Function &F, const AlignmentGraph &graph, const RollPlan &plan, bool rolled) {
+            ArrayRef<Value*> roots = graph.values(plan.root);
+            Instruction *I = cast<Instruction>(roots[0]);
+            *Log << "hw1 decision: " << F.getName() << ": " << I->getOpcodeName() << " x " << roots.size();
+            if (I->hasName()) *Log << " at %" << I->getName();
+            if (rolled && plan.vector_width) *Log << ": vectorized, " << plan.vector_width << " lanes";
+            else *Log << ": " << (rolled ? "rolled" : "kept");
+            if (!rolled) *Log << " (" << plan.reason << ")";
+            if (plan.size[0] || plan.size[1]) {
+                *Log << ", size " << plan.size[0] << " -> " << plan.size[1]
+                     << ", latency " << plan.latency[0] << " -> " << plan.latency[1];
+            }
+            *Log << "\n";
+        }
 
-            builder.SetInsertPoint(endLoop->getTerminator());
-            Value* incr;
-            if (monoOp[0] == MonotonicOp::ADD) {
-                incr = builder.CreateAdd(phi, ConstantInt::get(*context, APInt(64, mono[2])));
+        // -pass-remarks=hw1 reports rolled groups, -pass-remarks-missed=hw1
+        // the ones kept and why; -pass-remarks-output writes both as YAML.
+        void emit_remark(const AlignmentGraph &graph, const RollPlan &plan, bool rolled) {
+            if (!ORE) return;
+            Instruction *I = cast<Instruction>(graph.values(plan.root)[0]);
+            unsigned members = graph.nodes[plan.root].num_values;
+            auto sizes = [&](DiagnosticInfoOptimizationBase &R) {
+                if (!plan.size[0] && !plan.size[1]) return;
+                R << " (size " << ore::NV("SizeBefore", plan.size[0]) << " -> " << ore::NV("SizeAfter", plan.size[1]) << ")";
+            };
+            if (rolled) {
+                ORE->emit([&]() {
+                    OptimizationRemark R(DEBUG_TYPE, plan.vector_width ? "Vectorized" : "Rolled", I);
+                    R << "group of " << ore::NV("Members", members) << " " << ore::NV("Opcode", I->getOpcodeName());
+                    if (plan.vector_width) R << " turned into vector code of " << ore::NV("Lanes", plan.vector_width) << " lanes";
+                    else R << " rolled into a loop of " << ore::NV("TripCount", plan.trip_count) << " iterations";
+                    sizes(R);
+                    return R;
+                });
             } else {
-                incr = builder.CreateMul(phi, ConstantInt::get(*context, APInt(64, mono[2])));
+                ORE->emit([&]() {
+                    OptimizationRemarkMissed R(DEBUG_TYPE, "NotRolled", I);
+                    R << "group of " << ore::NV("Members", members) << " " << ore::NV("Opcode", I->getOpcodeName())
+                      << " not rolled: " << ore::NV("Reason", plan.reason);
+                    sizes(R);
+                    return R;
+                });
             }
-            Value* cond;
-            if (mono[2] > 0) {
-                cond = builder.CreateICmpSLE(incr, ConstantInt::get(*context, APInt(64, mono[1])));
-            } else {
-                cond = builder.CreateICmpSGE(incr, ConstantInt::get(*context, APInt(64, mono[1])));
+        }
+
+        // Clones orig with the given operands. A widened cast whose source
+        // now has another type is created anew from its opcode.
+        static Instruction *clone_with_operands(Instruction *orig, ArrayRef<Value*> ops) {
+            if (CastInst *CI = dyn_cast<CastInst>(orig)) {
+                if (ops[0]->getType() != CI->getSrcTy()) return CastInst::Create(CI->getOpcode(), ops[0], CI->getDestTy());
             }
-            builder.CreateCondBr(cond, loopBody, last);
-            endLoop->getTerminator()->eraseFromParent();
-            phi->addIncoming(incr, endLoop);
-            
-            erasePrevInstructions(graph);
+            Instruction *clone = orig->clone();
+            for (unsigned i = 0; i < ops.size(); ++i) clone->setOperand(i, ops[i]);
+            return clone;
         }
 
-		virtual bool runOnFunction(Function &F) override{
-            /* *******Implementation of Your code ******* */
-            std::vector<Node> graphs;
-
-            Instruction* temp;
-            bool isFirstBB = true;
-            Instruction* deleteBranchInstruction;
-            std::vector<Instruction*> deleteInstrs;
-            GetElementPtrInst* getElemPtrInst;
-            LoadInst* loadInst;
-            SExtInst* sextInst;
-            BasicBlock* deleteBB;
-            for (auto bb = F.getBasicBlockList().begin(); bb != F.getBasicBlockList().end(); ++bb) {
-                for (auto L = bb->begin(); L != bb->end(); ++L) {
-                    if ((std::string)L->getOpcodeName() == "br") {
-                        deleteBranchInstruction = &*L;
+        // The loop body clones the first member for every iteration, so the
+        // clone may only claim what holds for all members: the smallest
+        // alignment, the flags and tail call kind they share, and the
+        // metadata they agree on.
+        static void merge_members(Instruction *clone, ArrayRef<Value*> members) {
+            for (Value *V: members) {
+                Instruction *I = cast<Instruction>(V);
+                clone->andIRFlags(I);
+                if (LoadInst *L = dyn_cast<LoadInst>(clone)) {
+                    L->setAlignment(std::min(L->getAlign(), cast<LoadInst>(I)->getAlign()));
+                } else if (StoreInst *S = dyn_cast<StoreInst>(clone)) {
+                    S->setAlignment(std::min(S->getAlign(), cast<StoreInst>(I)->getAlign()));
+                } else if (CallInst *C = dyn_cast<CallInst>(clone)) {
+                    CallInst::TailCallKind kind = cast<CallInst>(I)->getTailCallKind();
+                    if (C->getTailCallKind() != kind) {
+                        C->setTailCallKind(C->isNoTailCall() || kind == CallInst::TCK_NoTail ? CallInst::TCK_NoTail : CallInst::TCK_None);
                     }
+                }
+            }
+            SmallVector<std::pair<unsigned, MDNode*>, 4> metadata;
+            clone->getAllMetadataOtherThanDebugLoc(metadata);
+            for (auto &item: metadata) {
+                if (any_of(members, [&](Value *V) { return cast<Instruction>(V)->getMetadata(item.first) != item.second; })) {
+                    clone->setMetadata(item.first, nullptr);
+                }
+            }
+        }
 
-                    if (isFirstBB) temp = &*L;
-                    else {
-                        if ((std::string)L->getOpcodeName() == "getelementptr") {
-                            getElemPtrInst = dyn_cast<GetElementPtrInst>(dyn_cast<Instruction>((&*L)->clone()));
-                            getElemPtrInst->insertAfter(temp);
-                            temp = getElemPtrInst;
+        // base + offset as a value of type ty; for a pointer base the offset
+        // counts bytes.
+        static Value *emit_offset(IRBuilder<> &builder, Value *base, Value *offset, Type *ty) {
+            if (!ty->isPointerTy()) return builder.CreateAdd(base, offset);
+            Value *bytes = builder.CreatePointerCast(base, builder.getInt8PtrTy(ty->getPointerAddressSpace()));
+            return builder.CreatePointerCast(builder.CreateGEP(builder.getInt8Ty(), bytes, offset), ty);
+        }
+
+        // start + iv * increment in type ty. The scaled induction variable
+        // is taken from terms when another sequence already computed it.
+        Value *emit_sequence(IRBuilder<> &builder, Value *iv, Type *ty, const MonotonicInfo &info, SharedTerms &terms) {
+            Value *&v = terms.scaled[{ty, info.increment}];
+            if (!v) {
+                Value *&converted = terms.casts[ty];
+                if (!converted) converted = builder.CreateSExtOrTrunc(iv, ty);
+                v = converted;
+                if (info.increment == -1) v = builder.CreateNeg(v);
+                else if (info.increment != 1) v = builder.CreateMul(v, ConstantInt::get(ty, info.increment, true));
+            }
+            if (info.start != 0) return builder.CreateAdd(v, ConstantInt::get(ty, info.start, true));
+            return v;
+        }
+
+        // Whether the group can become vector code instead of a loop: a store
+        // group over consecutive memory whose stored values are computed
+        // lane-wise by loads of consecutive memory, casts and binary
+        // operators. Address computations stay scalar. Returns the number of
+        // lanes per vector, or 0.
+        unsigned vector_width(const AlignmentGraph &graph, RollPlan &plan) {
+            ArrayRef<Value*> roots = graph.values(plan.root);
+            if (!TTI || !SE || !isa<StoreInst>(roots[0])) return 0;
+            const DataLayout &DL = plan.last->getModule()->getDataLayout();
+
+            DenseSet<NodeId> body(plan.body.begin(), plan.body.end());
+            DenseSet<NodeId> vector_ctx, scalar_ctx;
+            std::vector<std::pair<NodeId, bool>> worklist = {{plan.root, false}};
+            Type *stored = cast<StoreInst>(roots[0])->getValueOperand()->getType();
+            if (!stored->isIntegerTy() && !stored->isFloatingPointTy()) return 0;
+            unsigned max_bits = DL.getTypeSizeInBits(stored).getFixedSize();
+            while (!worklist.empty()) {
+                NodeId id = worklist.back().first;
+                bool vector = worklist.back().second;
+                worklist.pop_back();
+                const Node &n = graph.nodes[id];
+                Value *V0 = graph.values(id)[0];
+                if (!body.count(id)) {
+                    bool pointerOffsets = n.flag == NodeFlag::MONOTONIC_OFFSETS && V0->getType()->isPointerTy();
+                    if (vector && (n.flag == NodeFlag::MONOTONIC_ELEMENTS || pointerOffsets || !VectorType::isValidElementType(V0->getType()))) return 0;
+                    continue;
+                }
+                if (!(vector ? vector_ctx : scalar_ctx).insert(id).second) continue;
+                if (vector_ctx.count(id) && scalar_ctx.count(id)) return 0;
+
+                Instruction *I = cast<Instruction>(V0);
+                if (!vector) {
+                    if (id == plan.root) {
+                        worklist.push_back({graph.edge(id, 0), true});
+                        worklist.push_back({graph.edge(id, 1), false});
+                    } else {
+                        if (I->mayReadOrWriteMemory()) return 0;
+                        for (unsigned i = 0; i < n.num_edges; ++i) worklist.push_back({graph.edge(id, i), false});
+                    }
+                    continue;
+                }
+                Type *ty = I->getType();
+                if (!ty->isIntegerTy() && !ty->isFloatingPointTy()) return 0;
+                max_bits = std::max<unsigned>(max_bits, DL.getTypeSizeInBits(ty).getFixedSize());
+                if (isa<LoadInst>(I)) {
+                    if (!cast<LoadInst>(I)->isSimple()) return 0;
+                    worklist.push_back({graph.edge(id, 0), false});
+                } else if (isa<BinaryOperator>(I) || isa<CastInst>(I)) {
+                    for (unsigned i = 0; i < n.num_edges; ++i) worklist.push_back({graph.edge(id, i), true});
+                } else {
+                    return 0;
+                }
+            }
+            if (!cast<StoreInst>(roots[0])->isSimple()) return 0;
+
+            // lanes of every memory access must be consecutive, and all loads
+            // of a vector happen before its store, so a load may only see
+            // memory stored by the same lane
+            auto consecutive = [&](NodeId id) {
+                ArrayRef<Value*> values = graph.values(id);
+                for (unsigned k = 0; k + 1 < values.size(); ++k) {
+                    if (!isConsecutiveAccess(values[k], values[k + 1], DL, *SE)) return false;
+                }
+                return true;
+            };
+            if (!consecutive(plan.root)) return 0;
+            StoreInst *S = cast<StoreInst>(roots[0]);
+            for (NodeId id: vector_ctx) {
+                LoadInst *L = dyn_cast<LoadInst>(graph.values(id)[0]);
+                if (!L) continue;
+                if (!consecutive(id)) return 0;
+                Value *objS = getUnderlyingObject(S->getPointerOperand());
+                Value *objL = getUnderlyingObject(L->getPointerOperand());
+                if (objS != objL && isIdentifiedObject(objS) && isIdentifiedObject(objL)) continue;
+                Optional<int> diff = getPointersDiff(S->getValueOperand()->getType(), S->getPointerOperand(),
+                                                     L->getType(), L->getPointerOperand(), DL, *SE, false, true);
+                if (!diff || *diff != 0) return 0;
+            }
+
+            unsigned width = TTI->getRegisterBitWidth(TargetTransformInfo::RGK_FixedWidthVector).getFixedSize() / max_bits;
+            width = std::min<unsigned>(width, PowerOf2Floor(roots.size()));
+            if (width < 2) return 0;
+            plan.vector_nodes.assign(vector_ctx.begin(), vector_ctx.end());
+            return width;
+        }
+
+        // TTI size and latency of the vector code for the plan: full vectors
+        // of width lanes, then the leftover lanes as scalar code. Fills
+        // plan.size and plan.latency like is_profitable.
+        bool vector_costs(const AlignmentGraph &graph, RollPlan &plan, unsigned width) {
+            unsigned members = graph.nodes[plan.root].num_values;
+            unsigned chunks = members / width;
+            const TargetTransformInfo::TargetCostKind kinds[2] = {
+                TargetTransformInfo::TCK_CodeSize, TargetTransformInfo::TCK_Latency };
+            int64_t *results[2] = { plan.size, plan.latency };
+            DenseSet<NodeId> body(plan.body.begin(), plan.body.end());
+            for (unsigned c = 0; c < 2; ++c) {
+                TargetTransformInfo::TargetCostKind kind = kinds[c];
+                InstructionCost unrolled = 0, lane = 0, chunk = 0;
+                for (Instruction *I: plan.erase) unrolled += TTI->getInstructionCost(I, kind);
+                for (Instruction *I: plan.dead) unrolled += TTI->getInstructionCost(I, kind);
+                for (NodeId id: plan.body) {
+                    Instruction *I = cast<Instruction>(graph.values(id)[0]);
+                    lane += TTI->getInstructionCost(I, kind);
+                    bool vector = is_contained(plan.vector_nodes, id) || id == plan.root;
+                    if (!vector) {
+                        chunk += TTI->getInstructionCost(I, kind);
+                        continue;
+                    }
+                    Type *ty = isa<StoreInst>(I) ? cast<StoreInst>(I)->getValueOperand()->getType() : I->getType();
+                    FixedVectorType *vecTy = FixedVectorType::get(ty, width);
+                    if (isa<LoadInst>(I) || isa<StoreInst>(I)) {
+                        chunk += TTI->getMemoryOpCost(I->getOpcode(), vecTy, getLoadStoreAlignment(I), 0, kind);
+                    } else if (CastInst *CI = dyn_cast<CastInst>(I)) {
+                        chunk += TTI->getCastInstrCost(CI->getOpcode(), vecTy, FixedVectorType::get(CI->getSrcTy(), width),
+                                                       TargetTransformInfo::CastContextHint::None, kind);
+                    } else {
+                        chunk += TTI->getArithmeticInstrCost(I->getOpcode(), vecTy, kind);
+                    }
+                    for (unsigned i = 0; i < graph.nodes[id].num_edges; ++i) {
+                        NodeId e = graph.edge(id, i);
+                        if (isa<LoadInst>(I) || (id == plan.root && i == 1) || body.count(e)) continue;
+                        // operands from outside are splatted, or loaded from
+                        // the constant pool when they differ between lanes
+                        FixedVectorType *opTy = FixedVectorType::get(graph.values(e)[0]->getType(), width);
+                        if (!is_uniform(graph.values(e))) {
+                            chunk += TTI->getMemoryOpCost(Instruction::Load, opTy, Align(1), 0, kind);
+                        } else if (!isa<Constant>(graph.values(e)[0])) {
+                            chunk += TTI->getShuffleCost(TargetTransformInfo::SK_Broadcast, opTy, None, 0, nullptr);
                         }
-                        else if ((std::string)L->getOpcodeName() == "load") {
-                            loadInst = dyn_cast<LoadInst>((&*L)->clone());
-                            loadInst->setOperand(0, getElemPtrInst);
-                            loadInst->insertAfter(temp);
-                            temp = loadInst;
+                    }
+                }
+                InstructionCost vector = chunk * chunks + lane * (members - chunks * width);
+                if (!unrolled.isValid() || !vector.isValid()) return false;
+                results[c][0] = *unrolled.getValue();
+                results[c][1] = *vector.getValue();
+            }
+            return true;
+        }
+
+        // Replaces the seed group with vector code: for every full vector,
+        // the address computations of its first lane are cloned as scalars
+        // and everything else becomes one vector instruction per node.
+        // Leftover lanes are cloned as scalar code.
+        void generateVector(Function &F, const AlignmentGraph &graph, const RollPlan &plan) {
+            Instruction *firstRoot = cast<Instruction>(graph.values(plan.root)[0]);
+            IRBuilder<> builder(firstRoot);
+            const unsigned width = plan.vector_width;
+            const unsigned members = graph.nodes[plan.root].num_values;
+            std::vector<std::pair<Instruction*, std::string>> names;
+
+            for (unsigned base = 0; base < members; base += width) {
+                bool full = base + width <= members;
+                unsigned lanes = full ? 1 : members - base;
+                for (unsigned l = 0; l < lanes; ++l) {
+                    unsigned lane = base + l;
+                    DenseMap<NodeId, Value*> materialized;
+                    // leaves are used as they are, except offsets from a base,
+                    // which are computed again from the base like in the loop
+                    auto operand = [&](NodeId e) -> Value* {
+                        auto it = materialized.find(e);
+                        if (it != materialized.end()) return it->second;
+                        const Node &n = graph.nodes[e];
+                        if (n.flag != NodeFlag::MONOTONIC_OFFSETS || graph.values(e)[lane] == n.offset_base) return graph.values(e)[lane];
+                        Type *ty = graph.values(e)[0]->getType();
+                        int64_t offset = n.monotonicInfo.start + (int64_t) lane * n.monotonicInfo.increment;
+                        Constant *C = ConstantInt::get(SE->getEffectiveSCEVType(ty), offset, true);
+                        return materialized[e] = emit_offset(builder, n.offset_base, C, ty);
+                    };
+                    for (NodeId id: plan.body) {
+                        Instruction *orig = cast<Instruction>(graph.values(id)[lane]);
+                        bool vector = full && (id == plan.root || is_contained(plan.vector_nodes, id));
+                        if (!vector) {
+                            SmallVector<Value*, 4> ops;
+                            for (unsigned i = 0; i < graph.nodes[id].num_edges; ++i) ops.push_back(operand(graph.edge(id, i)));
+                            Instruction *clone = clone_with_operands(orig, ops);
+                            // operands follow the order of the first member
+                            if (CmpInst *C = dyn_cast<CmpInst>(clone)) C->setPredicate(cast<CmpInst>(graph.values(id)[0])->getPredicate());
+                            builder.Insert(clone);
+                            names.push_back({clone, orig->getName().str()});
+                            materialized[id] = clone;
+                            continue;
                         }
-                        else if ((std::string)L->getOpcodeName() == "sext") {
-                            sextInst = dyn_cast<SExtInst>((&*L)->clone());
-                            sextInst->setOperand(0, loadInst);
-                            sextInst->insertAfter(temp);
-                            temp = sextInst;
+
+                        SmallVector<Value*, 2> ops;
+                        for (unsigned i = 0; i < graph.nodes[id].num_edges; ++i) {
+                            NodeId e = graph.edge(id, i);
+                            Value *op = materialized.lookup(e);
+                            bool address = isa<LoadInst>(orig) || (isa<StoreInst>(orig) && i == 1);
+                            if (!op && address) op = operand(e);
+                            if (!op) {
+                                ArrayRef<Value*> values = graph.values(e).slice(lane, width);
+                                if (is_uniform(values)) {
+                                    op = builder.CreateVectorSplat(width, values[0]);
+                                } else if (graph.nodes[e].flag == NodeFlag::MONOTONIC_OFFSETS) {
+                                    SmallVector<Constant*, 8> offsets;
+                                    const MonotonicInfo &info = graph.nodes[e].monotonicInfo;
+                                    for (unsigned k = 0; k < width; ++k) {
+                                        offsets.push_back(ConstantInt::get(values[0]->getType(), info.start + (int64_t) (lane + k) * info.increment, true));
+                                    }
+                                    op = builder.CreateAdd(builder.CreateVectorSplat(width, graph.nodes[e].offset_base), ConstantVector::get(offsets));
+                                } else {
+                                    SmallVector<Constant*, 8> elements;
+                                    for (Value *C: values) elements.push_back(cast<Constant>(C));
+                                    op = ConstantVector::get(elements);
+                                }
+                            }
+                            ops.push_back(op);
                         }
-                        else if ((std::string)L->getOpcodeName() == "call") {
-                            CallInst* callInst = dyn_cast<CallInst>((&*L)->clone());
-                            callInst->setOperand(0, sextInst);
-                            callInst->insertAfter(temp);
-                            temp = callInst;
+
+                        Value *v;
+                        if (LoadInst *L = dyn_cast<LoadInst>(orig)) {
+                            FixedVectorType *vecTy = FixedVectorType::get(L->getType(), width);
+                            Value *ptr = builder.CreateBitCast(ops[0], vecTy->getPointerTo(L->getPointerAddressSpace()));
+                            v = builder.CreateAlignedLoad(vecTy, ptr, L->getAlign());
+                        } else if (StoreInst *S = dyn_cast<StoreInst>(orig)) {
+                            Value *ptr = builder.CreateBitCast(ops[1], ops[0]->getType()->getPointerTo(S->getPointerAddressSpace()));
+                            v = builder.CreateAlignedStore(ops[0], ptr, S->getAlign());
+                        } else if (CastInst *CI = dyn_cast<CastInst>(orig)) {
+                            v = builder.CreateCast(CI->getOpcode(), ops[0], FixedVectorType::get(CI->getDestTy(), width));
+                        } else {
+                            v = builder.CreateBinOp(cast<BinaryOperator>(orig)->getOpcode(), ops[0], ops[1]);
+                            if (Instruction *I = dyn_cast<Instruction>(v)) {
+                                I->copyIRFlags(orig);
+                                for (unsigned k = 1; k < width; ++k) I->andIRFlags(graph.values(id)[lane + k]);
+                            }
                         }
+                        materialized[id] = v;
+                    }
+                }
+            }
+
+            for (Instruction *I: plan.erase) I->dropAllReferences();
+            for (Instruction *I: plan.erase) I->eraseFromParent();
+            for (Instruction *I: plan.dead) I->eraseFromParent();
+            for (auto &item: names) item.first->setName(item.second);
+        }
+
+        // Maps every block to the first block of its region of control
+        // equivalent blocks: a block joins the region of its immediate
+        // dominator when it post-dominates it, so both always run together.
+        DenseMap<BasicBlock*, BasicBlock*> find_regions(Function &F) {
+            DenseMap<BasicBlock*, BasicBlock*> region;
+            for (BasicBlock &BB: F) region[&BB] = &BB;
+            if (!DT || !PDT) return region;
+            for (DomTreeNode *N: depth_first(DT->getRootNode())) {
+                DomTreeNode *IDom = N->getIDom();
+                if (IDom && PDT->dominates(N->getBlock(), IDom->getBlock())) {
+                    region[N->getBlock()] = region[IDom->getBlock()];
+                }
+            }
+            return region;
+        }
+
+        // Merges the blocks from First to Last into First when they form a
+        // chain of unconditional fall-throughs. Returns false, leaving the
+        // blocks alone, when anything branches in or out in between.
+        bool join_blocks(BasicBlock *First, BasicBlock *Last) {
+            SmallVector<BasicBlock*, 8> chain;
+            for (BasicBlock *BB = First; BB != Last; BB = chain.back()) {
+                BranchInst *Br = dyn_cast<BranchInst>(BB->getTerminator());
+                if (!Br || !Br->isUnconditional()) return false;
+                BasicBlock *Succ = Br->getSuccessor(0);
+                if (Succ == First || Succ->getSinglePredecessor() != BB) return false;
+                chain.push_back(Succ);
+            }
+            DomTreeUpdater DTU(DT, PDT, DomTreeUpdater::UpdateStrategy::Eager);
+            bool merged = false;
+            for (BasicBlock *BB: chain) merged |= MergeBlockIntoPredecessor(BB, &DTU, LI);
+            return merged;
+        }
+
+        // Rerolls a single-block loop that -loop-unroll left with k copies of
+        // its body. The induction variable must advance by k equal steps,
+        // through a chain of adds or, after instcombine, by adds of m steps
+        // straight from the phi. The side effects of the block must split
+        // into k aligned lanes, lane m using the induction variable plus m
+        // steps, and the lanes must cover the whole block. The first lane is
+        // kept, the others are erased, and the loop advances one step per
+        // iteration instead of k.
+        bool reroll_loop(Function &F, Loop *L) {
+            BasicBlock *BB = L->getHeader();
+            BasicBlock *preHeader = L->getLoopPreheader();
+            if (L->getNumBlocks() != 1 || !preHeader) return false;
+            BranchInst *Br = dyn_cast<BranchInst>(BB->getTerminator());
+            if (!Br || !Br->isConditional()) return false;
+            ICmpInst *Cmp = dyn_cast<ICmpInst>(Br->getCondition());
+            if (!Cmp || Cmp->getParent() != BB || !Cmp->hasOneUse()) return false;
+
+            PHINode *iv = nullptr;
+            for (PHINode &P: BB->phis()) {
+                if (iv) return false;  // other phis carry values between copies
+                iv = &P;
+            }
+            if (!iv || !iv->getType()->isIntegerTy()) return false;
+
+            // the back-edge value is iv + k steps, and chain[m - 1] computes
+            // iv + m steps for every lane m, whether it adds a step to
+            // chain[m - 2] or adds m steps to iv
+            int64_t total;
+            Instruction *next = dyn_cast<Instruction>(iv->getIncomingValueForBlock(BB));
+            if (!next || next->getParent() != BB || strip_constant_offset(next, total) != iv || !total) return false;
+            DenseMap<int64_t, Instruction*> offsets;
+            int64_t step = total;
+            for (Instruction &I: *BB) {
+                int64_t offset;
+                if (!isa<BinaryOperator>(&I) || strip_constant_offset(&I, offset) != iv || !offset) continue;
+                if (!offsets.insert({offset, &I}).second) return false;
+                if ((offset > 0) == (total > 0) && std::abs(offset) < std::abs(step)) step = offset;
+            }
+            if (total % step != 0 || total / step < 2 || offsets.size() != (uint64_t) (total / step)) return false;
+            const unsigned k = total / step;
+            SmallVector<Instruction*, 8> chain;
+            for (unsigned m = 1; m <= k; ++m) {
+                auto it = offsets.find(m * step);
+                if (it == offsets.end()) return false;
+                chain.push_back(it->second);
+            }
+
+            // the rerolled loop tests the exit after every step instead of
+            // every k steps, so the distance to the bound must be a multiple
+            // of k steps for it to stop at the same point. instcombine may
+            // test iv or an earlier step instead of the last one; the bound
+            // is then shifted by the steps in between.
+            if (!SE) return false;
+            CmpInst::Predicate pred = Cmp->getPredicate();
+            unsigned side = 0;
+            if (Cmp->getOperand(0) != iv && !is_contained(chain, Cmp->getOperand(0))) {
+                side = 1;
+                pred = Cmp->getSwappedPredicate();
+            }
+            Value *tested = Cmp->getOperand(side), *bound = Cmp->getOperand(1 - side);
+            if (tested != iv && !is_contained(chain, tested)) return false;
+            int64_t testedOffset = 0;
+            if (tested != iv) strip_constant_offset(tested, testedOffset);
+            const int64_t shift = total - testedOffset;
+            if (Br->getSuccessor(0) != BB) pred = CmpInst::getInversePredicate(pred);
+            bool up = step > 0;
+            if (pred != CmpInst::ICMP_NE && pred != (up ? CmpInst::ICMP_ULT : CmpInst::ICMP_UGT) &&
+                pred != (up ? CmpInst::ICMP_SLT : CmpInst::ICMP_SGT)) return false;
+            if (!L->isLoopInvariant(bound)) return false;
+            const SCEV *start = SE->getSCEV(iv->getIncomingValueForBlock(preHeader));
+            const SCEV *end = SE->getAddExpr(SE->getSCEV(bound), SE->getConstant(bound->getType(), shift, true));
+            const SCEV *distance = up ? SE->getMinusSCEV(end, start) : SE->getMinusSCEV(start, end);
+            const SCEVConstant *D = dyn_cast<SCEVConstant>(distance);
+            if (!D || D->getAPInt().getActiveBits() > 63) return false;
+            int64_t stride = (int64_t) k * (up ? step : -step);
+            if (D->getAPInt().getSExtValue() <= 0 || D->getAPInt().getSExtValue() % stride != 0) return false;
+
+            // the side effects of lane m follow those of lane m - 1
+            std::vector<Value*> effects;
+            position.clear();
+            for (Instruction &I: *BB) {
+                position[&I] = position.size();
+                if (I.mayHaveSideEffects()) effects.push_back(&I);
+            }
+            if (effects.empty() || effects.size() % k != 0) return false;
+            unsigned perLane = effects.size() / k;
+
+            AlignmentGraph graph;
+            DenseMap<Instruction*, unsigned> lane;
+            std::vector<NodeId> body;
+            for (unsigned t = 0; t < perLane; ++t) {
+                std::vector<Value*> group;
+                for (unsigned m = 0; m < k; ++m) group.push_back(effects[m * perLane + t]);
+                NodeId root = create_alignment_graph(graph, group);
+                insert_monotonic_info(graph, root);
+
+                RollPlan plan;
+                bool varies = false;
+                SmallPtrSet<Instruction*, 32> tree;
+                SmallPtrSet<Value*, 16> leaves;
+                if (!graph.nodes[root].is_match || !collect_group(graph, root, plan, tree, leaves, varies)) return false;
+                for (NodeId id: plan.sequences) {
+                    const Node &n = graph.nodes[id];
+                    if (n.flag != NodeFlag::MONOTONIC_OFFSETS || n.offset_base != iv ||
+                        n.monotonicInfo.start != 0 || n.monotonicInfo.increment != step) return false;
+                }
+                for (NodeId id: plan.body) {
+                    body.push_back(id);
+                    ArrayRef<Value*> values = graph.values(id);
+                    for (unsigned m = 0; m < k; ++m) {
+                        auto inserted = lane.insert({cast<Instruction>(values[m]), m});
+                        if (!inserted.second && inserted.first->second != m) return false;
+                    }
+                }
+                for (Value *V: leaves) {
+                    if (isa<Instruction>(V) && lane.count(cast<Instruction>(V))) return false;
+                }
+            }
+
+            // the lanes have to be the whole block, apart from the induction
+            // variable and the exit test, and must not feed each other
+            SmallPtrSet<Instruction*, 8> control(chain.begin(), chain.end());
+            control.insert(iv);
+            control.insert(Cmp);
+            control.insert(Br);
+            std::vector<unsigned> first(k, ~0u), last(k, 0);
+            for (Instruction &I: *BB) {
+                if (control.count(&I) || isa<DbgInfoIntrinsic>(&I)) continue;
+                auto it = lane.find(&I);
+                if (it == lane.end()) return false;
+                for (User *U: I.users()) {
+                    auto use = lane.find(dyn_cast<Instruction>(U));
+                    if (use == lane.end() || use->second != it->second) return false;
+                }
+                if (I.mayReadOrWriteMemory()) {
+                    first[it->second] = std::min(first[it->second], position[&I]);
+                    last[it->second] = std::max(last[it->second], position[&I]);
+                }
+            }
+            for (unsigned m = 1; m < k; ++m) {
+                if (first[m] != ~0u && last[m - 1] > first[m]) return false;
+            }
+            // only the later lanes, the next link and the exit test may use
+            // the steps, which all become iv + step
+            for (unsigned m = 0; m < k; ++m) {
+                for (User *U: chain[m]->users()) {
+                    if (U == iv || U == Cmp || (m + 1 < k && U == chain[m + 1])) continue;
+                    auto use = lane.find(dyn_cast<Instruction>(U));
+                    if (use == lane.end() || use->second == 0) return false;
+                }
+            }
+
+            if (DecisionLog) {
+                *Log << "hw1 decision: " << F.getName() << ": loop %" << BB->getName() << ": rerolled " << k << " copies\n";
+            }
+            if (ORE) {
+                ORE->emit([&]() {
+                    return OptimizationRemark(DEBUG_TYPE, "Rerolled", L->getStartLoc(), BB)
+                           << "loop holding " << ore::NV("Copies", k) << " copies of its body rerolled";
+                });
+            }
+            ++NumRerolled;
+            // lane 0 stands for all lanes from now on
+            for (NodeId id: body) merge_members(cast<Instruction>(graph.values(id)[0]), graph.values(id));
+            std::vector<Instruction*> erase;
+            for (auto &item: lane) {
+                if (item.second != 0) erase.push_back(item.first);
+            }
+            for (Instruction *I: erase) I->dropAllReferences();
+            for (Instruction *I: erase) I->eraseFromParent();
+            // the steps may be ors that only hold for multiples of k steps,
+            // so the loop advances by a fresh add, tested against the
+            // shifted bound
+            Instruction *advance = BinaryOperator::CreateAdd(iv, ConstantInt::get(iv->getType(), step, true), "", Cmp);
+            advance->copyIRFlags(chain.back());
+            advance->takeName(chain[0]);
+            if (shift) {
+                IRBuilder<> builder(preHeader->getTerminator());
+                Cmp->setOperand(1 - side, builder.CreateAdd(bound, ConstantInt::get(bound->getType(), shift, true)));
+            }
+            Cmp->setOperand(side, advance);
+            iv->setIncomingValueForBlock(BB, advance);
+            for (unsigned m = k; m-- > 0; ) chain[m]->eraseFromParent();
+            SE->forgetLoop(L);
+            return true;
+        }
+
+        static int64_t power(int64_t base, unsigned exponent) {
+            uint64_t result = 1;
+            for (unsigned i = 0; i < exponent; ++i) result *= (uint64_t) base;
+            return (int64_t) result;
+        }
+
+        // Replaces the seed group with a counted loop whose body holds
+        // plan.unroll clones of every matched instruction node, one per
+        // member handled in the iteration. Monotonic constant nodes become
+        // expressions of the induction variable, which counts members.
+        void generateLoop(Function &F, const AlignmentGraph &graph, const RollPlan &plan) {
+            LLVMContext &context = F.getContext();
+            Instruction *firstRoot = cast<Instruction>(graph.values(plan.root)[0]);
+            BasicBlock *preHeader = firstRoot->getParent();
+            BasicBlock *exit = SplitBlock(preHeader, firstRoot);
+            BasicBlock *loopBody = BasicBlock::Create(context, "roll.body", &F, exit);
+            preHeader->getTerminator()->setSuccessor(0, loopBody);
+
+            IRBuilder<> builder(loopBody);
+            Type *ivTy = plan.iv_type;
+            PHINode *iv = builder.CreatePHI(ivTy, 2, "roll.iv");
+            iv->addIncoming(ConstantInt::get(ivTy, 0), preHeader);
+
+            std::vector<std::pair<Instruction*, std::string>> names;
+            DenseMap<NodeId, PHINode*> mulPhis;
+            DenseMap<NodeId, GlobalVariable*> tables;
+            for (NodeId id: plan.sequences) {
+                const MonotonicInfo &info = graph.nodes[id].monotonicInfo;
+                if (graph.nodes[id].flag == NodeFlag::CONSTANT_TABLE) {
+                    ArrayRef<Value*> values = graph.values(id);
+                    ArrayType *tableTy = ArrayType::get(values[0]->getType(), values.size());
+                    SmallVector<Constant*, 16> elements;
+                    for (Value *C: values) elements.push_back(cast<Constant>(C));
+                    GlobalVariable *table = new GlobalVariable(*F.getParent(), tableTy, true, GlobalValue::PrivateLinkage,
+                                                               ConstantArray::get(tableTy, elements), "roll.table");
+                    table->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+                    tables[id] = table;
+                } else if (info.monotonic_op == MonotonicOp::MUL) {
+                    Type *ty = graph.values(id)[0]->getType();
+                    PHINode *phi = builder.CreatePHI(ty, 2, "roll.mul");
+                    phi->addIncoming(ConstantInt::get(ty, info.start, true), preHeader);
+                    mulPhis[id] = phi;
+                }
+            }
+
+            for (unsigned copy = 0; copy < plan.unroll; ++copy) {
+                Value *index = copy == 0 ? (Value*) iv : builder.CreateAdd(iv, ConstantInt::get(ivTy, copy));
+                DenseMap<NodeId, Value*> materialized;
+                SharedTerms terms;
+                for (NodeId id: plan.sequences) {
+                    const MonotonicInfo &info = graph.nodes[id].monotonicInfo;
+                    Type *ty = graph.values(id)[0]->getType();
+                    Value *v;
+                    if (graph.nodes[id].flag == NodeFlag::CONSTANT_TABLE) {
+                        GlobalVariable *table = tables[id];
+                        Value *slot = builder.CreateInBoundsGEP(table->getValueType(), table, {builder.getInt64(0), index});
+                        v = builder.CreateLoad(ty, slot);
+                    } else if (info.monotonic_op == MonotonicOp::MUL) {
+                        v = mulPhis[id];
+                        if (copy != 0) v = builder.CreateMul(v, ConstantInt::get(ty, power(info.increment, copy), true));
+                    } else if (graph.nodes[id].flag == NodeFlag::MONOTONIC_ELEMENTS) {
+                        GEPOperator *gep = cast<GEPOperator>(graph.values(id)[0]);
+                        SmallVector<Value*, 4> indices(gep->idx_begin(), gep->idx_end());
+                        indices.back() = emit_sequence(builder, index, indices.back()->getType(), info, terms);
+                        v = gep->isInBounds()
+                            ? builder.CreateInBoundsGEP(gep->getSourceElementType(), gep->getPointerOperand(), indices)
+                            : builder.CreateGEP(gep->getSourceElementType(), gep->getPointerOperand(), indices);
+                    } else if (graph.nodes[id].flag == NodeFlag::MONOTONIC_OFFSETS) {
+                        Value *base = graph.nodes[id].offset_base;
+                        v = emit_offset(builder, base, emit_sequence(builder, index, SE->getEffectiveSCEVType(ty), info, terms), ty);
+                    } else {
+                        v = emit_sequence(builder, index, ty, info, terms);
+                    }
+                    materialized[id] = v;
+                }
+
+                for (NodeId id: plan.body) {
+                    Instruction *orig = cast<Instruction>(graph.values(id)[0]);
+                    SmallVector<Value*, 4> ops;
+                    for (unsigned i = 0; i < graph.nodes[id].num_edges; ++i) {
+                        NodeId e = graph.edge(id, i);
+                        auto it = materialized.find(e);
+                        ops.push_back(it != materialized.end() ? it->second : graph.values(e)[0]);
+                    }
+                    Instruction *clone = clone_with_operands(orig, ops);
+                    merge_members(clone, graph.values(id));
+                    builder.Insert(clone);
+                    names.push_back({clone, graph.values(id)[copy]->getName().str()});
+                    materialized[id] = clone;
+                }
+                if (index != iv && index->use_empty()) cast<Instruction>(index)->eraseFromParent();
+            }
+
+            Value *next = builder.CreateAdd(iv, ConstantInt::get(ivTy, plan.unroll), "roll.iv.next");
+            for (auto &item: mulPhis) {
+                PHINode *phi = item.second;
+                int64_t step = power(graph.nodes[item.first].monotonicInfo.increment, plan.unroll);
+                Value *mul = builder.CreateMul(phi, ConstantInt::get(phi->getType(), step, true));
+                phi->addIncoming(mul, loopBody);
+            }
+            Value *cond = builder.CreateICmpULT(next, ConstantInt::get(ivTy, (uint64_t) plan.trip_count * plan.unroll), "roll.cond");
+            builder.CreateCondBr(cond, loopBody, exit);
+            iv->addIncoming(next, loopBody);
+
+            for (Instruction *I: plan.erase) I->dropAllReferences();
+            for (Instruction *I: plan.erase) I->eraseFromParent();
+            for (Instruction *I: plan.dead) I->eraseFromParent();
+            for (auto &item: names) item.first->setName(item.second);
+        }
+
+        // MD5 of everything the decisions for F depend on, in a form that is
+        // the same in every run: the instructions with their types, flags and
+        // constant operands, local values numbered in order, which blocks are
+        // hot, the target and the pass options. Names and metadata are left
+        // out, so moving code around in the source does not change it.
+        std::string function_hash(Function &F) {
+            const Module *M = F.getParent();
+            DenseMap<const Value*, unsigned> number;
+            for (Argument &A: F.args()) number[&A] = number.size();
+            for (BasicBlock &BB: F) {
+                number[&BB] = number.size();
+                for (Instruction &I: BB) number[&I] = number.size();
+            }
+
+            std::string text;
+            raw_string_ostream os(text);
+            os << M->getDataLayoutStr() << ' ' << M->getTargetTriple() << ' ' << *F.getFunctionType() << ' '
+               << F.getAttributes().getFnAttrs().getAsString() << '\n';
+            os << HashConsGraph.getValue() << ' ' << MaxGraphDepth.getValue() << ' ' << ConstantTables.getValue() << ' '
+               << HotBlockRatio.getValue() << ' ' << UnrollFactor.getValue() << ' ' << HotUnrollFactor.getValue() << ' '
+               << MinSizeGain.getValue() << ' ' << MaxLatencyIncrease.getValue() << ' ' << Vectorize.getValue() << ' '
+               << ReorderOperands.getValue() << ' ' << WidenCasts.getValue() << ' ' << IndirectCalls.getValue() << ' '
+               << IndirectCallPenalty.getValue() << ' ' << ICacheUnitCost.getValue() << '\n';
+            for (BasicBlock &BB: F) {
+                os << "block " << is_hot(&BB) << '\n';
+                for (Instruction &I: BB) {
+                    if (isa<DbgInfoIntrinsic>(&I)) continue;
+                    os << I.getOpcodeName() << ' ' << *I.getType() << ' ' << (unsigned) I.getRawSubclassOptionalData();
+                    if (CmpInst *C = dyn_cast<CmpInst>(&I)) os << ' ' << C->getPredicate();
+                    if (LoadInst *L = dyn_cast<LoadInst>(&I)) os << ' ' << L->isVolatile() << ' ' << L->getAlign().value();
+                    if (StoreInst *S = dyn_cast<StoreInst>(&I)) os << ' ' << S->isVolatile() << ' ' << S->getAlign().value();
+                    if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(&I)) os << ' ' << *GEP->getSourceElementType();
+                    if (AllocaInst *AI = dyn_cast<AllocaInst>(&I)) os << ' ' << *AI->getAllocatedType();
+                    if (PHINode *P = dyn_cast<PHINode>(&I)) {
+                        for (BasicBlock *In: P->blocks()) os << " %" << number.lookup(In);
+                    }
+                    if (CallBase *CB = dyn_cast<CallBase>(&I)) {
+                        os << ' ' << CB->getAttributes().getFnAttrs().getAsString();
+                        if (Function *callee = CB->getCalledFunction()) os << ' ' << callee->getAttributes().getFnAttrs().getAsString();
+                    }
+                    for (Value *Op: I.operands()) {
+                        auto it = number.find(Op);
+                        if (it != number.end()) os << " %" << it->second;
                         else {
-                            Instruction* cloneInstr = (&*L)->clone();
-                            cloneInstr->insertAfter(temp);
-                            temp = cloneInstr;
+                            os << ' ';
+                            Op->printAsOperand(os, true, M);
                         }
-
-                        deleteInstrs.push_back(&*L);
                     }
+                    os << '\n';
                 }
+            }
+
+            MD5 hash;
+            hash.update(os.str());
+            MD5::MD5Result result;
+            hash.final(result);
+            return result.digest().str().str();
+        }
+
+        // -hw1-cache-dir entry of the function: the number of seed groups,
+        // how many of them were in hot blocks, and one line per rolled group
+        // with its seed index, unroll factor and vector width.
+        struct CachedPlan {
+            unsigned seed;
+            unsigned unroll;
+            unsigned vector_width;
+        };
+        std::string cache_key;
+        bool cache_loaded = false;
+        bool cache_hit = false;
+        unsigned cached_hot = 0;
+        std::vector<CachedPlan> cached;
+
+        std::string cache_path() const {
+            SmallString<128> path(CacheDir.getValue());
+            sys::path::append(path, cache_key + ".hw1");
+            return std::string(path.str());
+        }
 
-                if (!isFirstBB) {
-                    deleteBB = &*bb;
+        bool load_cache() {
+            ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(cache_path());
+            if (!buffer) return false;
+            SmallVector<StringRef, 16> lines;
+            (*buffer)->getBuffer().split(lines, '\n', -1, false);
+            unsigned num_seeds = ~0u;
+            for (StringRef line: lines) {
+                SmallVector<StringRef, 4> fields;
+                line.split(fields, ' ');
+                if (fields.size() == 2 && fields[0] == "seeds") {
+                    if (fields[1].getAsInteger(10, num_seeds)) return false;
+                } else if (fields.size() == 2 && fields[0] == "hot") {
+                    if (fields[1].getAsInteger(10, cached_hot)) return false;
+                } else if (fields.size() == 4 && fields[0] == "roll") {
+                    CachedPlan entry;
+                    if (fields[1].getAsInteger(10, entry.seed) || fields[2].getAsInteger(10, entry.unroll) ||
+                        fields[3].getAsInteger(10, entry.vector_width)) return false;
+                    cached.push_back(entry);
+                } else {
+                    return false;
                 }
+            }
+            return num_seeds == seeds.size();
+        }
 
-                isFirstBB = false;
+        // Written to a temporary file first, so that opt processes sharing
+        // the directory never read half an entry.
+        void store_cache() {
+            if (sys::fs::create_directories(CacheDir)) return;
+            int fd;
+            SmallString<128> temp;
+            if (sys::fs::createUniqueFile(cache_path() + ".%%%%%%", fd, temp)) return;
+            {
+                raw_fd_ostream os(fd, true);
+                os << "seeds " << seeds.size() << "\n";
+                os << "hot " << hot << "\n";
+                for (const RollPlan &plan: plans) {
+                    os << "roll " << plan.seed << " " << plan.unroll << " " << plan.vector_width << "\n";
+                }
             }
-            if (F.getBasicBlockList().size() > 1) {
-                deleteBranchInstruction->eraseFromParent();
-                DeleteDeadBlock(&*deleteBB);
+            if (sys::fs::rename(temp, cache_path())) sys::fs::remove(temp);
+        }
+
+        // Rolls the groups named by the cache entry, building only their
+        // graphs and skipping the cost model. Legality is still checked, so
+        // a stale entry can only cost code size; if any group fails, the
+        // function is planned from scratch instead.
+        bool replay(Function &F) {
+            for (const CachedPlan &entry: cached) {
+                if (entry.seed >= seeds.size()) return false;
+                NodeId root;
+                {
+                    NamedRegionTimer T("graph", "Alignment graph construction", TimerGroupName, TimerGroupDescription, timing());
+                    root = create_alignment_graph(graph, seeds[entry.seed]);
+                }
+                {
+                    NamedRegionTimer T("monotonic", "Monotonic annotation", TimerGroupName, TimerGroupDescription, timing());
+                    insert_monotonic_info(graph, root);
+                }
+                graph.roots.push_back(root);
+
+                RollPlan plan;
+                if (!canRoll(graph, root, plan)) return false;
+                plan.seed = entry.seed;
+                auto lock = lock_context();
+                if (entry.vector_width) {
+                    if (!Vectorize || vector_width(graph, plan) != entry.vector_width) return false;
+                    plan.vector_width = entry.vector_width;
+                } else {
+                    if (entry.unroll > 1 && !set_unroll(graph, plan, entry.unroll)) return false;
+                    plan.iv_type = iv_type(graph, plan);
+                }
+                plans.push_back(plan);
+            }
+            hot = cached_hot;
+            if (DecisionLog) {
+                for (const RollPlan &plan: plans) log_decision(F, graph, plan, true);
             }
+            return true;
+        }
+
+        // state carried from one phase of run() to the next
+        bool Changed = false;
+        unsigned sizeBefore = 0;
+        unsigned hot = 0;
+        std::vector<std::vector<Value*>> seeds;
+        AlignmentGraph graph;
+        std::vector<RollPlan> plans;
+        std::vector<RollPlan> kept;  // for the missed remarks
+
+        bool run(Function &F) {
+            prepare(F);
+            decide(F);
+            return commit(F);
+        }
 
-            for (auto bb = F.getBasicBlockList().begin(); bb != F.getBasicBlockList().end(); ++bb) {
-                std::unordered_map<std::pair<Value*, Type::TypeID>, std::vector<Value*>, hash_pair> storeMap;
-                std::unordered_map<Value*, std::vector<Value*>> functionMap;
-                for (auto L = bb->begin(); L != bb->end(); ++L) {
+        // Rerolls unrolled loops, gathers the seed groups and joins the
+        // blocks they are split across. Changes the IR.
+        void prepare(Function &F) {
+            sizeBefore = F.getInstructionCount();
+
+            if (Reroll && LI) {
+                NamedRegionTimer T("reroll", "Loop rerolling", TimerGroupName, TimerGroupDescription, timing());
+                for (Loop *L: LI->getLoopsInPreorder()) {
+                    if (L->isInnermost() && reroll_loop(F, L)) Changed = true;
+                }
+            }
+
+            Optional<NamedRegionTimer> seedTimer;
+            seedTimer.emplace("seeds", "Seed collection", TimerGroupName, TimerGroupDescription, timing());
+            // seeds are gathered per region of control-equivalent blocks, in
+            // reverse post order so members appear in execution order
+            DenseMap<BasicBlock*, BasicBlock*> region = find_regions(F);
+            ReversePostOrderTraversal<Function*> RPOT(&F);
+            // stores are grouped by the object they write to, so that e.g.
+            // a[0] = x; a[1] = y; ... form one seed group
+            MapVector<std::pair<BasicBlock*, std::pair<Value*, Type*>>, std::vector<Value*>> storeMap;
+            // calls are grouped by callee and number of arguments, which
+            // differs between calls to a variadic function
+            MapVector<std::pair<BasicBlock*, std::pair<Value*, unsigned>>, std::vector<Value*>> functionMap;
+            for (BasicBlock *BB: RPOT) {
+                BasicBlock *leader = region.lookup(BB);
+                for (auto L = BB->begin(); L != BB->end(); ++L) {
                     const int opCode = L->getOpcode();
                     if (opCode == Instruction::Store) {
-                        storeMap[{ L->getOperand(0), L->getType()->getTypeID()}].push_back(&(*L));
+                        StoreInst *SI = cast<StoreInst>(L);
+                        if (SI->isVolatile()) continue;
+                        storeMap[{leader, {getUnderlyingObject(SI->getPointerOperand()), SI->getValueOperand()->getType()}}].push_back(&(*L));
                     } else if (opCode == Instruction::Call) {
-                        functionMap[L->getOperand(1)].push_back(&(*L));
+                        CallInst *CI = cast<CallInst>(L);
+                        functionMap[{leader, {CI->getCalledOperand(), CI->arg_size()}}].push_back(CI);
                     }
                 }
-                // errs()<<"store size: " << storeMap.size() << "\n";
-                // errs()<<"func size: " << storeMap.size() << "\n";
+            }
 
-                for (auto item: storeMap) {
-                    graphs.push_back(create_alignment_graph(item.second));
+            // members split across fall-through blocks are rolled together
+            // after joining the blocks; the rest is rolled per block
+            auto add_seeds = [&](std::vector<Value*> &members) {
+                BasicBlock *current = cast<Instruction>(members.front())->getParent();
+                for (Value *V: members) {
+                    BasicBlock *BB = cast<Instruction>(V)->getParent();
+                    if (BB == current) continue;
+                    if (join_blocks(current, BB)) Changed = true;
+                    else current = BB;
                 }
-
-                for (auto item: functionMap) {
-                    graphs.push_back(create_alignment_graph(item.second));
+                MapVector<BasicBlock*, std::vector<Value*>> perBlock;
+                for (Value *V: members) perBlock[cast<Instruction>(V)->getParent()].push_back(V);
+                for (auto &item: perBlock) seeds.push_back(std::move(item.second));
+            };
+            for (auto &item: storeMap) add_seeds(item.second);
+            // with -hw1-indirect-calls, calls that are the only ones to their
+            // callee in the region are grouped again by signature, so that
+            // init_a(); init_b(); init_c(); can loop over a table
+            MapVector<std::pair<BasicBlock*, std::pair<FunctionType*, void*>>, std::vector<Value*>> signatureMap;
+            for (auto &item: functionMap) {
+                CallInst *CI = cast<CallInst>(item.second[0]);
+                Function *callee = CI->getCalledFunction();
+                if (IndirectCalls && item.second.size() == 1 && callee && !callee->isIntrinsic()) {
+                    signatureMap[{item.first.first, {CI->getFunctionType(), CI->getAttributes().getRawPointer()}}].push_back(CI);
+                } else {
+                    add_seeds(item.second);
                 }
+            }
+            for (auto &item: signatureMap) add_seeds(item.second);
+
+            position.clear();
+            for (Instruction &I: instructions(F)) position[&I] = position.size();
 
-                for (int j = 0; j < graphs.size(); ++j) {
-                    graphs[j] = insert_monotonic_info(graphs[j]);
-                }      
+            NumSeeds += seeds.size();
+            seedTimer.reset();
+            if (!CacheDir.empty()) {
+                NamedRegionTimer T("cache", "Decision cache lookup", TimerGroupName, TimerGroupDescription, timing());
+                cache_key = function_hash(F);
+                cache_loaded = load_cache();
             }
 
-            errs() << "Original Code" << '\n';
-            for (auto bb = F.getBasicBlockList().begin(); bb != F.getBasicBlockList().end(); ++bb) {
-                for (BasicBlock::iterator i = bb->begin(), e = bb->end(); i != e; ++i) {
-                    errs() << *i << '\n';
+            if (PrintCode) {
+                *Log << "Original Code" << '\n';
+                for (auto bb = F.getBasicBlockList().begin(); bb != F.getBasicBlockList().end(); ++bb) {
+                    for (BasicBlock::iterator i = bb->begin(), e = bb->end(); i != e; ++i) {
+                        *Log << *i << '\n';
+                    }
+                    *Log << ' ' << '\n';
                 }
-                errs() << ' ' << '\n';
+
+                *Log << "\n\n\n";
             }
+        }
 
-            errs() << "\n\n\n";
+        // Builds the alignment graphs and decides which groups to roll. Only
+        // reads the IR, so functions can be planned concurrently.
+        void decide(Function &F) {
+            if (cache_loaded) {
+                if (replay(F)) {
+                    ++CacheHits;
+                    cache_hit = true;
+                    return;
+                }
+                graph = AlignmentGraph();
+                plans.clear();
+            }
+            if (!CacheDir.empty()) ++CacheMisses;
 
-            for (Node graph: graphs) {
-                //print_graph(graph, 0);
+            {
+                NamedRegionTimer T("graph", "Alignment graph construction", TimerGroupName, TimerGroupDescription, timing());
+                for (std::vector<Value*> &members: seeds) graph.roots.push_back(create_alignment_graph(graph, members));
+            }
+            {
+                NamedRegionTimer T("monotonic", "Monotonic annotation", TimerGroupName, TimerGroupDescription, timing());
+                for (NodeId root: graph.roots) insert_monotonic_info(graph, root);
+            }
 
-                if (canRoll(graph)) {
-                    generateLoop(F, graph);
+            // plan every group before touching the IR; groups whose ranges
+            // overlap an already accepted group are left alone
+            Optional<NamedRegionTimer> planTimer;
+            planTimer.emplace("plan", "Legality and cost model", TimerGroupName, TimerGroupDescription, timing());
+            for (unsigned s = 0; s < graph.roots.size(); ++s) {
+                NodeId root = graph.roots[s];
+                if (PrintGraph) print_graph(graph, root);
+
+                RollPlan plan;
+                bool roll = canRoll(graph, root, plan);
+                plan.seed = s;
+                if (graph.nodes[root].is_match && graph.nodes[root].num_values > 1) ++NumMatched;
+                bool hotBlock = roll && is_hot(plan.first->getParent());
+                if (hotBlock) ++hot;
+                auto lock = lock_context();  // TTI and SCEV queries from here on
+
+                // the loop as generateLoop would emit it, unrolled as the
+                // block asks for
+                RollPlan loop = plan;
+                bool loopOk = roll;
+                unsigned unroll = UnrollFactor;
+                if (hotBlock) {
+                    if (!HotUnrollFactor) loopOk = reject(loop, "hot block");
+                    else if (!unroll) unroll = HotUnrollFactor;
                 }
-
+                if (loopOk && unroll > 1) loopOk = set_unroll(graph, loop, unroll);
+                loopOk = loopOk && is_profitable(graph, loop);
+
+                // vector code wins on hot blocks when it is faster, and
+                // elsewhere when it is smaller than that loop; otherwise the
+                // loop plan, with its own costs, replaces it
+                unsigned width = roll && Vectorize ? vector_width(graph, plan) : 0;
+                if (width && vector_costs(graph, plan, width)) {
+                    bool vecOk = hotBlock ? plan.latency[1] < plan.latency[0]
+                                          : plan.size[1] + MinSizeGain <= plan.size[0] && (!loopOk || plan.size[1] <= loop.size[1]);
+                    if (vecOk) plan.vector_width = width;
+                }
+                if (!plan.vector_width) {
+                    plan = loop;
+                    roll = loopOk;
+                }
+                for (const RollPlan &other: plans) {
+                    if (roll && position[plan.first] <= position[other.last] && position[other.first] <= position[plan.last]) {
+                        roll = reject(plan, "overlaps a group already rolled");
+                    }
+                }
+                if (roll) plans.push_back(plan);
+                else kept.push_back(plan);
+                if (DecisionLog && graph.nodes[root].num_values > 1) log_decision(F, graph, plan, roll);
+            }
+            planTimer.reset();
+            if (!CacheDir.empty()) {
+                NamedRegionTimer T("cache", "Decision cache lookup", TimerGroupName, TimerGroupDescription, timing());
+                store_cache();
             }
+        }
 
-            errs() << "Altered Code" << '\n';
-            for (auto bb = F.getBasicBlockList().begin(); bb != F.getBasicBlockList().end(); ++bb) {
-                for (BasicBlock::iterator i = bb->begin(), e = bb->end(); i != e; ++i) {
-                    errs() << *i << '\n';
+        // Applies the plans and reports. Changes the IR.
+        bool commit(Function &F) {
+            // kept groups may share instructions with rolled ones, so they
+            // are reported before anything is erased
+            for (const RollPlan &plan: kept) {
+                if (graph.nodes[plan.root].num_values > 1) emit_remark(graph, plan, false);
+            }
+            NamedRegionTimer T("codegen", "Code generation", TimerGroupName, TimerGroupDescription, timing());
+            for (const RollPlan &plan: plans) {
+                emit_remark(graph, plan, true);
+                if (plan.vector_width) {
+                    generateVector(F, graph, plan);
+                    ++NumVectorized;
+                } else {
+                    generateLoop(F, graph, plan);
+                    ++NumRolled;
+                }
+                Changed = true;
+            }
+            unsigned sizeAfter = F.getInstructionCount();
+            if (sizeAfter < sizeBefore) NumRemoved += sizeBefore - sizeAfter;
+
+            if (PrintCode) {
+                *Log << "Altered Code" << '\n';
+                for (auto bb = F.getBasicBlockList().begin(); bb != F.getBasicBlockList().end(); ++bb) {
+                    for (BasicBlock::iterator i = bb->begin(), e = bb->end(); i != e; ++i) {
+                        *Log << *i << '\n';
+                    }
+                    *Log << ' ' << '\n';
                 }
-                errs() << ' ' << '\n';
             }
 
-			return false; // template code is just return false
+            if (ReportSize) {
+                *Log << "hw1 size: " << F.getName() << ": " << sizeBefore << " -> "
+                     << sizeAfter << " instructions, " << plans.size() << " groups rolled, "
+                     << hot << " in hot blocks";
+                if (!CacheDir.empty()) *Log << ", cache " << (cache_hit ? "hit" : "miss");
+                *Log << "\n";
+            }
+
+            return Changed;
+        }
+    };
+
+	struct HW1: public FunctionPass {
+        static char ID;
+		HW1() : FunctionPass(ID) {
+        }
+
+        void getAnalysisUsage(AnalysisUsage &AU) const{
+            AU.addRequired<BlockFrequencyInfoWrapperPass>(); // Analysis pass to load block execution count
+            AU.addRequired<BranchProbabilityInfoWrapperPass>();  // Analysis pass to load branch probability
+            AU.addRequired<TargetTransformInfoWrapperPass>();  // Code size and latency of the rolled loop
+            AU.addRequired<ScalarEvolutionWrapperPass>();  // Consecutive accesses for vector code
+            AU.addRequired<DominatorTreeWrapperPass>();  // Regions of control-equivalent blocks
+            AU.addRequired<PostDominatorTreeWrapperPass>();
+            AU.addRequired<LoopInfoWrapperPass>();  // Kept up to date when blocks are joined
+            AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
+        }
+
+		virtual bool runOnFunction(Function &F) override{
+            LoopRoller roller;
+            roller.BFI = &getAnalysis<BlockFrequencyInfoWrapperPass>().getBFI();
+            roller.BPI = &getAnalysis<BranchProbabilityInfoWrapperPass>().getBPI();
+            roller.TTI = &getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+            roller.SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+            roller.DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+            roller.PDT = &getAnalysis<PostDominatorTreeWrapperPass>().getPostDomTree();
+            roller.LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+            roller.ORE = &getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
+            return roller.run(F);
 		}
 	};
+
+    static void get_analyses(LoopRoller &roller, Function &F, FunctionAnalysisManager &FAM) {
+        roller.BFI = &FAM.getResult<BlockFrequencyAnalysis>(F);
+        roller.BPI = &FAM.getResult<BranchProbabilityAnalysis>(F);
+        roller.TTI = &FAM.getResult<TargetIRAnalysis>(F);
+        roller.SE = &FAM.getResult<ScalarEvolutionAnalysis>(F);
+        roller.DT = &FAM.getResult<DominatorTreeAnalysis>(F);
+        roller.PDT = &FAM.getResult<PostDominatorTreeAnalysis>(F);
+        roller.LI = &FAM.getResult<LoopAnalysis>(F);
+        roller.ORE = &FAM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+    }
+
+    // New pass manager version of HW1. Analyses come from the function
+    // analysis manager, so results cached by earlier passes are reused.
+    struct HW1Pass: public PassInfoMixin<HW1Pass> {
+        PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+            LoopRoller roller;
+            get_analyses(roller, F, FAM);
+            if (!roller.run(F)) return PreservedAnalyses::all();
+            return PreservedAnalyses::none();
+        }
+    };
+
+    // Module version, -passes=hw1-module. Functions are prepared one after
+    // the other, then decided concurrently on -hw1-threads workers, and the
+    // plans are committed in module order. Dumps and decisions are buffered
+    // per function and printed in module order as well, so the output does
+    // not depend on the number of threads.
+    struct HW1ModulePass: public PassInfoMixin<HW1ModulePass> {
+        PreservedAnalyses run(Module &M, ModuleAnalysisManager &MAM) {
+            FunctionAnalysisManager &FAM = MAM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+            std::vector<Function*> functions;
+            for (Function &F: M) {
+                // optnone functions are skipped, as the function pipeline does
+                if (!F.isDeclaration() && !F.hasOptNone()) functions.push_back(&F);
+            }
+
+            std::mutex contextLock;
+            std::vector<LoopRoller> rollers(functions.size());
+            std::vector<std::string> logs(functions.size());
+            std::vector<std::unique_ptr<raw_string_ostream>> streams;
+            for (unsigned i = 0; i < functions.size(); ++i) {
+                streams.push_back(std::make_unique<raw_string_ostream>(logs[i]));
+                rollers[i].Log = streams[i].get();
+                get_analyses(rollers[i], *functions[i], FAM);
+                rollers[i].prepare(*functions[i]);
+            }
+
+            ThreadPool pool(hardware_concurrency(Threads));
+            for (unsigned i = 0; i < functions.size(); ++i) {
+                rollers[i].ContextLock = &contextLock;
+                pool.async([&, i] { rollers[i].decide(*functions[i]); });
+            }
+            pool.wait();
+
+            bool Changed = false;
+            for (unsigned i = 0; i < functions.size(); ++i) {
+                rollers[i].ContextLock = nullptr;
+                if (rollers[i].commit(*functions[i])) Changed = true;
+                errs() << streams[i]->str();
+            }
+            if (!Changed) return PreservedAnalyses::all();
+            return PreservedAnalyses::none();
+        }
+    };
 }
 char HW1::ID = 0;
 static RegisterPass<HW1> X("hw1", "HW1 pass",
     false /* Only looks at CFG */,
     false /* Analysis Pass */);
+
+// Lets the pass be loaded with -load-pass-plugin and run as -passes=hw1. With
+// -hw1-in-default-pipeline it also slots in at the end of the scalar
+// optimizer of the default pipelines (-O2, -Os, ...).
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo() {
+    return {LLVM_PLUGIN_API_VERSION, "HW1", LLVM_VERSION_STRING, [](PassBuilder &PB) {
+        PB.registerPipelineParsingCallback(
+            [](StringRef Name, FunctionPassManager &FPM, ArrayRef<PassBuilder::PipelineElement>) {
+                if (Name != "hw1") return false;
+                FPM.addPass(HW1Pass());
+                return true;
+            });
+        PB.registerPipelineParsingCallback(
+            [](StringRef Name, ModulePassManager &MPM, ArrayRef<PassBuilder::PipelineElement>) {
+                if (Name != "hw1-module") return false;
+                MPM.addPass(HW1ModulePass());
+                return true;
+            });
+        PB.registerScalarOptimizerLateEPCallback(
+            [](FunctionPassManager &FPM, OptimizationLevel Level) {
+                if (Level == OptimizationLevel::O0 || !DefaultPipeline) return;
+                FPM.addPass(HW1Pass());
+            });
+    }};
+}
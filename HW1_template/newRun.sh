@@ -56,7 +56,25 @@ setup
 
 # opt -loops -loop-rotate -loop-simplify -loop-unroll -unroll-count=3 -unroll-allow-partial -enable-new-pm=0 -o ${1}.fplicm.bc -pgo-instr-use -pgo-test-profile-file=pgo.profdata -load ${PATH_MYPASS} ${NAME_MYPASS} < ${1}.bc > /dev/null
 
+# USE_NEW_PM=1 ./newRun.sh ... runs the same pipeline through the new pass manager plugin interface
+# The same pipeline without the pass gives the baseline the sizes below are
+# compared against.
+if [[ "${USE_NEW_PM}" == "1" ]]; then
+PIPELINE="pgo-instr-use,function(mem2reg,simplifycfg,lcssa,loop-simplify,loop(loop-rotate),loop-unroll"
+opt -passes="${PIPELINE},hw1)" -unroll-count=3 -unroll-allow-partial -o ${1}.fplicm.bc -pgo-test-profile-file=pgo.profdata -load-pass-plugin ${PATH_MYPASS} < ${1}.bc > /dev/null
+opt -passes="${PIPELINE})" -unroll-count=3 -unroll-allow-partial -o ${1}.unrolled.bc -pgo-test-profile-file=pgo.profdata < ${1}.bc > /dev/null
+else
 opt -mem2reg -simplifycfg -loops -lcssa -loop-simplify -loop-rotate -loop-unroll -unroll-count=3 -unroll-allow-partial -enable-new-pm=0 -o ${1}.fplicm.bc -pgo-instr-use -pgo-test-profile-file=pgo.profdata -load ${PATH_MYPASS} ${NAME_MYPASS} < ${1}.bc > /dev/null
+opt -mem2reg -simplifycfg -loops -lcssa -loop-simplify -loop-rotate -loop-unroll -unroll-count=3 -unroll-allow-partial -enable-new-pm=0 -o ${1}.unrolled.bc -pgo-instr-use -pgo-test-profile-file=pgo.profdata < ${1}.bc > /dev/null
+fi
+
+# code size before and after rolling; the .text size of the object is what
+# the rolled code occupies in the instruction cache
+llc -filetype=obj ${1}.unrolled.bc -o ${1}.unrolled.o
+llc -filetype=obj ${1}.fplicm.bc -o ${1}.fplicm.o
+echo "text size before: $(llvm-size -A ${1}.unrolled.o | awk '$1 == ".text" { print $2 }')"
+echo "text size after:  $(llvm-size -A ${1}.fplicm.o | awk '$1 == ".text" { print $2 }')"
+rm ${1}.unrolled.o ${1}.fplicm.o
 
 clang ${1}.fplicm.bc -o ${1}_fplicm
 ./${1}_fplicm > fplicm_output
\ No newline at end of file
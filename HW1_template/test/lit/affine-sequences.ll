@@ -0,0 +1,109 @@
+; Constant operands are read as affine sequences start + k * step in their
+; own width, with negative steps, steps that wrap around the type and
+; integers wider than 64 bits, or as geometric sequences start * ratio^k.
+; Addresses that count down are byte offsets with a negative stride; the
+; address of the first member is computed in the loop like the others.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+
+declare void @f(i32)
+declare void @w(i128)
+declare void @b(i8)
+
+; LOG: hw1 decision: down: call x 5: rolled, size 10 -> 7, latency 200 -> 225
+; CHECK-LABEL: @down(
+; CHECK: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[SCALED:%.*]] = mul i32 %roll.iv, -3
+; CHECK-NEXT: [[VALUE:%.*]] = add i32 [[SCALED]], 10
+; CHECK-NEXT: call void @f(i32 [[VALUE]])
+define void @down() {
+entry:
+  call void @f(i32 10)
+  call void @f(i32 7)
+  call void @f(i32 4)
+  call void @f(i32 1)
+  call void @f(i32 -2)
+  ret void
+}
+
+; LOG: hw1 decision: powers: call x 5: rolled, size 10 -> 6, latency 200 -> 220
+; CHECK-LABEL: @powers(
+; CHECK: %roll.iv = phi i8 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: %roll.mul = phi i32 [ 1, %entry ], [ [[NEXT:%.*]], %roll.body ]
+; CHECK-NEXT: call void @f(i32 %roll.mul)
+; CHECK-NEXT: %roll.iv.next = add i8 %roll.iv, 1
+; CHECK-NEXT: [[NEXT]] = mul i32 %roll.mul, 2
+define void @powers() {
+entry:
+  call void @f(i32 1)
+  call void @f(i32 2)
+  call void @f(i32 4)
+  call void @f(i32 8)
+  call void @f(i32 16)
+  ret void
+}
+
+; LOG: hw1 decision: wide: call x 6: rolled, size 12 -> 8, latency 240 -> 276
+; CHECK-LABEL: @wide(
+; CHECK: %roll.iv = phi i8 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[WIDE:%.*]] = sext i8 %roll.iv to i128
+; CHECK-NEXT: [[NEG:%.*]] = sub i128 0, [[WIDE]]
+; CHECK-NEXT: [[VALUE:%.*]] = add i128 [[NEG]], -1
+; CHECK-NEXT: call void @w(i128 [[VALUE]])
+define void @wide() {
+entry:
+  call void @w(i128 -1)
+  call void @w(i128 -2)
+  call void @w(i128 -3)
+  call void @w(i128 -4)
+  call void @w(i128 -5)
+  call void @w(i128 -6)
+  ret void
+}
+
+; 100, 120, 140 and 160 in eight bits.
+; LOG: hw1 decision: wraps: call x 4: rolled, size 8 -> 7, latency 160 -> 180
+; CHECK-LABEL: @wraps(
+; CHECK: %roll.iv = phi i8 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[SCALED:%.*]] = mul i8 %roll.iv, 20
+; CHECK-NEXT: [[VALUE:%.*]] = add i8 [[SCALED]], 100
+; CHECK-NEXT: call void @b(i8 [[VALUE]])
+define void @wraps() {
+entry:
+  call void @b(i8 100)
+  call void @b(i8 120)
+  call void @b(i8 -116)
+  call void @b(i8 -96)
+  ret void
+}
+
+; LOG: hw1 decision: reversed: store x 6: rolled, size 11 -> 7, latency 11 -> 42
+; CHECK-LABEL: @reversed(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: br label %roll.body
+; CHECK: %roll.iv = phi i64 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[SCALED:%.*]] = mul i64 %roll.iv, -4
+; CHECK-NEXT: [[OFFSET:%.*]] = add i64 [[SCALED]], 20
+; CHECK-NEXT: [[BYTES:%.*]] = bitcast i32* %p to i8*
+; CHECK-NEXT: [[ADDRESS:%.*]] = getelementptr i8, i8* [[BYTES]], i64 [[OFFSET]]
+; CHECK-NEXT: [[PTR:%.*]] = bitcast i8* [[ADDRESS]] to i32*
+; CHECK-NEXT: store i32 0, i32* [[PTR]], align 4
+; CHECK-NEXT: %roll.iv.next = add i64 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i64 %roll.iv.next, 6
+define void @reversed(i32* %p) {
+entry:
+  %p5 = getelementptr inbounds i32, i32* %p, i64 5
+  store i32 0, i32* %p5, align 4
+  %p4 = getelementptr inbounds i32, i32* %p, i64 4
+  store i32 0, i32* %p4, align 4
+  %p3 = getelementptr inbounds i32, i32* %p, i64 3
+  store i32 0, i32* %p3, align 4
+  %p2 = getelementptr inbounds i32, i32* %p, i64 2
+  store i32 0, i32* %p2, align 4
+  %p1 = getelementptr inbounds i32, i32* %p, i64 1
+  store i32 0, i32* %p1, align 4
+  store i32 0, i32* %p, align 4
+  ret void
+}
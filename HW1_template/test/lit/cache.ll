@@ -0,0 +1,43 @@
+; With -hw1-cache-dir the roll decisions of each function are stored under
+; a hash of its IR and of the options that change them. A second run over
+; the same module replays them without planning and rolls the same groups;
+; other options make it plan again.
+; RUN: rm -rf %t
+; RUN: %hw1 -passes=hw1 -hw1-cache-dir=%t -hw1-report-size -S %s -o %t.first.ll 2>&1 | FileCheck %s --check-prefix=MISS
+; RUN: %hw1 -passes=hw1 -hw1-cache-dir=%t -hw1-report-size -S %s -o %t.second.ll 2>&1 | FileCheck %s --check-prefix=HIT
+; RUN: FileCheck %s < %t.first.ll
+; RUN: FileCheck %s < %t.second.ll
+; RUN: %hw1 -passes=hw1 -hw1-cache-dir=%t -hw1-report-size -hw1-min-size-gain=5 -disable-output %s 2>&1 | FileCheck %s --check-prefix=MISS
+
+declare void @f(i32)
+
+; MISS: hw1 size: five: 6 -> 7 instructions, 1 groups rolled, 0 in hot blocks, cache miss
+; HIT: hw1 size: five: 6 -> 7 instructions, 1 groups rolled, 0 in hot blocks, cache hit
+; CHECK-LABEL: @five(
+; CHECK: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: call void @f(i32 %roll.iv)
+; CHECK-NEXT: %roll.iv.next = add i32 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i32 %roll.iv.next, 5
+define void @five() {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  call void @f(i32 3)
+  call void @f(i32 4)
+  ret void
+}
+
+; MISS: hw1 size: same: 5 -> 5 instructions, 0 groups rolled, 0 in hot blocks, cache miss
+; HIT: hw1 size: same: 5 -> 5 instructions, 0 groups rolled, 0 in hot blocks, cache hit
+; CHECK-LABEL: @same(
+; CHECK-NOT: roll.body
+; CHECK: ret void
+define void @same() {
+entry:
+  call void @f(i32 5)
+  call void @f(i32 5)
+  call void @f(i32 5)
+  call void @f(i32 5)
+  ret void
+}
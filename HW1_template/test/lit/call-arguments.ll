@@ -0,0 +1,78 @@
+; Calls whose arguments vary in several positions are rolled with one
+; induction variable; each argument gets its own affine or geometric
+; expression of it, and the loads of printf("%d %d", a[i], b[2 * i]) each
+; get their own index.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+
+@a = global [8 x i32] zeroinitializer
+@b = global [16 x i32] zeroinitializer
+
+declare void @pair(i32, i32)
+declare void @triple(i32, i64, i32)
+
+; LOG: hw1 decision: indices: call x 4: rolled, size 12 -> 7, latency 160 -> 176
+; CHECK-LABEL: @indices(
+; CHECK: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[DOUBLE:%.*]] = mul i32 %roll.iv, 2
+; CHECK-NEXT: call void @pair(i32 %roll.iv, i32 [[DOUBLE]])
+; CHECK-NEXT: %roll.iv.next = add i32 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i32 %roll.iv.next, 4
+define void @indices() {
+entry:
+  call void @pair(i32 0, i32 0)
+  call void @pair(i32 1, i32 2)
+  call void @pair(i32 2, i32 4)
+  call void @pair(i32 3, i32 6)
+  ret void
+}
+
+; LOG: hw1 decision: three_ways: call x 5: rolled, size 20 -> 13, latency 200 -> 245
+; CHECK-LABEL: @three_ways(
+; CHECK: %roll.iv = phi i8 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: %roll.mul = phi i32 [ 1, %entry ], [ [[POWER:%.*]], %roll.body ]
+; CHECK-NEXT: [[I32:%.*]] = sext i8 %roll.iv to i32
+; CHECK-NEXT: [[NEG:%.*]] = sub i32 0, [[I32]]
+; CHECK-NEXT: [[DOWN:%.*]] = add i32 [[NEG]], 10
+; CHECK-NEXT: [[I64:%.*]] = sext i8 %roll.iv to i64
+; CHECK-NEXT: [[TRIPLE:%.*]] = mul i64 [[I64]], 3
+; CHECK-NEXT: call void @triple(i32 [[DOWN]], i64 [[TRIPLE]], i32 %roll.mul)
+; CHECK-NEXT: %roll.iv.next = add i8 %roll.iv, 1
+; CHECK-NEXT: [[POWER]] = mul i32 %roll.mul, 2
+define void @three_ways() {
+entry:
+  call void @triple(i32 10, i64 0, i32 1)
+  call void @triple(i32 9, i64 3, i32 2)
+  call void @triple(i32 8, i64 6, i32 4)
+  call void @triple(i32 7, i64 9, i32 8)
+  call void @triple(i32 6, i64 12, i32 16)
+  ret void
+}
+
+; LOG: hw1 decision: loads: call x 4: rolled, size 20 -> 11, latency 192 -> 216
+; CHECK-LABEL: @loads(
+; CHECK: %roll.iv = phi i64 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[PA:%.*]] = getelementptr inbounds [8 x i32], [8 x i32]* @a, i64 0, i64 %roll.iv
+; CHECK-NEXT: [[J:%.*]] = mul i64 %roll.iv, 2
+; CHECK-NEXT: [[PB:%.*]] = getelementptr inbounds [16 x i32], [16 x i32]* @b, i64 0, i64 [[J]]
+; CHECK-NEXT: %a0 = load i32, i32* [[PA]], align 4
+; CHECK-NEXT: %b0 = load i32, i32* [[PB]], align 4
+; CHECK-NEXT: call void @pair(i32 %a0, i32 %b0)
+define void @loads() {
+entry:
+  %a0 = load i32, i32* getelementptr inbounds ([8 x i32], [8 x i32]* @a, i64 0, i64 0), align 4
+  %b0 = load i32, i32* getelementptr inbounds ([16 x i32], [16 x i32]* @b, i64 0, i64 0), align 4
+  call void @pair(i32 %a0, i32 %b0)
+  %a1 = load i32, i32* getelementptr inbounds ([8 x i32], [8 x i32]* @a, i64 0, i64 1), align 4
+  %b1 = load i32, i32* getelementptr inbounds ([16 x i32], [16 x i32]* @b, i64 0, i64 2), align 4
+  call void @pair(i32 %a1, i32 %b1)
+  %a2 = load i32, i32* getelementptr inbounds ([8 x i32], [8 x i32]* @a, i64 0, i64 2), align 4
+  %b2 = load i32, i32* getelementptr inbounds ([16 x i32], [16 x i32]* @b, i64 0, i64 4), align 4
+  call void @pair(i32 %a2, i32 %b2)
+  %a3 = load i32, i32* getelementptr inbounds ([8 x i32], [8 x i32]* @a, i64 0, i64 3), align 4
+  %b3 = load i32, i32* getelementptr inbounds ([16 x i32], [16 x i32]* @b, i64 0, i64 6), align 4
+  call void @pair(i32 %a3, i32 %b3)
+  ret void
+}
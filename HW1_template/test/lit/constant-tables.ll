@@ -0,0 +1,47 @@
+; Constants that follow no progression are read from a private table
+; indexed by the loop counter, when the loop still pays off.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -hw1-constant-tables=0 -disable-output %s 2>&1 | FileCheck %s --check-prefix=OFF
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+
+; CHECK: @roll.table = private unnamed_addr constant [6 x i32] [i32 3, i32 1, i32 4, i32 1, i32 5, i32 9]
+; CHECK-NOT: @roll.table
+
+declare void @f(i32)
+
+; LOG: hw1 decision: digits: call x 6: rolled, size 12 -> 7
+; OFF: hw1 decision: digits: call x 6: kept (operands do not align)
+; CHECK-LABEL: @digits(
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i64 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[ENTRY:%.*]] = getelementptr inbounds [6 x i32], [6 x i32]* @roll.table, i64 0, i64 %roll.iv
+; CHECK-NEXT: [[ARG:%.*]] = load i32, i32* [[ENTRY]], align 4
+; CHECK-NEXT: call void @f(i32 [[ARG]])
+; CHECK-NEXT: %roll.iv.next = add i64 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i64 %roll.iv.next, 6
+; CHECK-NOT: call
+; CHECK: ret void
+define void @digits() {
+entry:
+  call void @f(i32 3)
+  call void @f(i32 1)
+  call void @f(i32 4)
+  call void @f(i32 1)
+  call void @f(i32 5)
+  call void @f(i32 9)
+  ret void
+}
+
+; Two calls do not pay for a table and a loop.
+; LOG: hw1 decision: pair: call x 2: kept (loop is not smaller than the group), size 4 -> 7
+; CHECK-LABEL: @pair(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void @f(i32 3)
+; CHECK-NEXT: call void @f(i32 1)
+; CHECK-NEXT: ret void
+define void @pair() {
+entry:
+  call void @f(i32 3)
+  call void @f(i32 1)
+  ret void
+}
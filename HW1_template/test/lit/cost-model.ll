@@ -0,0 +1,69 @@
+; The cost model rolls a group only when the loop saves at least
+; -hw1-min-size-gain instructions and, when -hw1-max-latency-increase is set,
+; adds at most that much estimated latency. A group whose members are all the
+; same has nothing for an induction variable to count and is never rolled.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -hw1-min-size-gain=5 -disable-output %s 2>&1 | FileCheck %s --check-prefix=GAIN
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -hw1-max-latency-increase=0 -disable-output %s 2>&1 | FileCheck %s --check-prefix=SLOW
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -hw1-max-latency-increase=10 -disable-output %s 2>&1 | FileCheck %s --check-prefix=BOUND
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+; RUN: %hw1 -passes=hw1 -hw1-min-size-gain=5 -S %s | FileCheck %s --check-prefix=KEPT
+
+declare void @f(i32)
+
+; LOG: hw1 decision: three: call x 3: rolled, size 6 -> 5, latency 120 -> 129
+; GAIN: hw1 decision: three: call x 3: kept (loop is not smaller than the group), size 6 -> 5, latency 120 -> 129
+; SLOW: hw1 decision: three: call x 3: kept (loop is too slow), size 6 -> 5, latency 120 -> 129
+; BOUND: hw1 decision: three: call x 3: rolled, size 6 -> 5, latency 120 -> 129
+; CHECK-LABEL: @three(
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: call void @f(i32 %roll.iv)
+; CHECK-NEXT: %roll.iv.next = add i32 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i32 %roll.iv.next, 3
+; CHECK-NEXT: br i1 %roll.cond, label %roll.body, label %entry.split
+; KEPT-LABEL: @three(
+; KEPT-NEXT: entry:
+; KEPT-NEXT: call void @f(i32 0)
+; KEPT-NEXT: call void @f(i32 1)
+; KEPT-NEXT: call void @f(i32 2)
+; KEPT-NEXT: ret void
+define void @three() {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  ret void
+}
+
+; LOG: hw1 decision: five: call x 5: rolled, size 10 -> 5, latency 200 -> 215
+; GAIN: hw1 decision: five: call x 5: rolled, size 10 -> 5, latency 200 -> 215
+; SLOW: hw1 decision: five: call x 5: kept (loop is too slow), size 10 -> 5, latency 200 -> 215
+; BOUND: hw1 decision: five: call x 5: rolled, size 10 -> 5, latency 200 -> 215
+; CHECK-LABEL: @five(
+; CHECK: %roll.cond = icmp ult i32 %roll.iv.next, 5
+; KEPT-LABEL: @five(
+; KEPT: %roll.cond = icmp ult i32 %roll.iv.next, 5
+define void @five() {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  call void @f(i32 3)
+  call void @f(i32 4)
+  ret void
+}
+
+; LOG: hw1 decision: same: call x 4: kept (nothing varies between members)
+; CHECK-LABEL: @same(
+; CHECK-NOT: roll.body
+; CHECK-COUNT-4: call void @f(i32 5)
+; CHECK-NEXT: ret void
+define void @same() {
+entry:
+  call void @f(i32 5)
+  call void @f(i32 5)
+  call void @f(i32 5)
+  call void @f(i32 5)
+  ret void
+}
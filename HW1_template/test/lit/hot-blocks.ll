@@ -0,0 +1,68 @@
+; With profile data, groups in blocks that run at least -hw1-hot-ratio times
+; per function entry keep -hw1-hot-unroll-factor copies per iteration, or
+; stay unrolled when that factor is 0. Cold groups are rolled fully.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -hw1-report-size -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -hw1-hot-unroll-factor=0 -disable-output %s 2>&1 | FileCheck %s --check-prefix=SKIP
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -hw1-hot-ratio=1000 -disable-output %s 2>&1 | FileCheck %s --check-prefix=COLD
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+
+declare void @f(i32)
+
+; The loop runs about 100 times per call.
+; LOG: hw1 decision: profiled: call x 8: rolled, size 16 -> 5
+; LOG-NEXT: hw1 decision: profiled: call x 8: rolled, size 16 -> 11
+; LOG-NEXT: hw1 size: profiled: {{.*}}, 2 groups rolled, 1 in hot blocks
+; SKIP: hw1 decision: profiled: call x 8: rolled, size 16 -> 5
+; SKIP-NEXT: hw1 decision: profiled: call x 8: kept (hot block)
+; COLD: hw1 decision: profiled: call x 8: rolled, size 16 -> 5
+; COLD-NEXT: hw1 decision: profiled: call x 8: rolled, size 16 -> 5
+; CHECK-LABEL: @profiled(
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: call void @f(i32 %roll.iv)
+; CHECK-NEXT: %roll.iv.next = add i32 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i32 %roll.iv.next, 8
+; CHECK: loop:
+; CHECK: [[BODY:roll.body[0-9]+]]:
+; CHECK-NEXT: [[IV:%roll.iv[0-9]+]] = phi i32 [ 0, %loop ], [ [[NEXT:%roll.iv.next[0-9]+]], %[[BODY]] ]
+; CHECK-NEXT: call void @f(i32 [[IV]])
+; CHECK-NEXT: [[I1:%.*]] = add i32 [[IV]], 1
+; CHECK-NEXT: call void @f(i32 [[I1]])
+; CHECK-NEXT: [[I2:%.*]] = add i32 [[IV]], 2
+; CHECK-NEXT: call void @f(i32 [[I2]])
+; CHECK-NEXT: [[I3:%.*]] = add i32 [[IV]], 3
+; CHECK-NEXT: call void @f(i32 [[I3]])
+; CHECK-NEXT: [[NEXT]] = add i32 [[IV]], 4
+; CHECK-NEXT: {{%roll.cond[0-9]+}} = icmp ult i32 [[NEXT]], 8
+define void @profiled(i32 %n) !prof !0 {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  call void @f(i32 3)
+  call void @f(i32 4)
+  call void @f(i32 5)
+  call void @f(i32 6)
+  call void @f(i32 7)
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  call void @f(i32 3)
+  call void @f(i32 4)
+  call void @f(i32 5)
+  call void @f(i32 6)
+  call void @f(i32 7)
+  %i.next = add i32 %i, 1
+  %c = icmp ult i32 %i.next, %n
+  br i1 %c, label %loop, label %exit, !prof !1
+
+exit:
+  ret void
+}
+
+!0 = !{!"function_entry_count", i64 10}
+!1 = !{!"branch_weights", i32 99, i32 1}
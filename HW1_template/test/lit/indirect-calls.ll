@@ -0,0 +1,69 @@
+; With -hw1-indirect-calls, calls that are the only ones to their callee
+; are grouped by signature and rolled into a loop over a private table of
+; the callees. The loop must save more I-cache cycles per function entry
+; (-hw1-icache-unit-cost per unit of code size) than the indirect calls cost
+; over direct ones (-hw1-indirect-call-penalty per call). Without the option
+; calls to different functions never form a group.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --allow-empty --check-prefix=OFF
+; RUN: %hw1 -passes=hw1 -hw1-indirect-calls -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -hw1-indirect-calls -hw1-indirect-call-penalty=100 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=COSTLY
+; RUN: %hw1 -passes=hw1 -hw1-indirect-calls -S %s | FileCheck %s
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s --check-prefix=DIRECT
+
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+
+declare void @init_0(i32)
+declare void @init_1(i32)
+declare void @init_2(i32)
+declare void @init_3(i32)
+declare void @init_4(i32)
+declare void @init_5(i32)
+declare void @init_6(i32)
+declare void @init_7(i32)
+declare void @init_8(i32)
+declare void @init_9(i32)
+
+; OFF-NOT: hw1 decision
+; LOG: hw1 decision: inits: call x 10: rolled, size 20 -> 8, latency 400 -> 480
+; COSTLY: hw1 decision: inits: call x 10: kept (indirect calls cost more than the code they save), size 20 -> 8, latency 400 -> 1460
+; CHECK: @roll.table = private unnamed_addr constant [10 x void (i32)*] [void (i32)* @init_0, void (i32)* @init_1, void (i32)* @init_2, void (i32)* @init_3, void (i32)* @init_4, void (i32)* @init_5, void (i32)* @init_6, void (i32)* @init_7, void (i32)* @init_8, void (i32)* @init_9]
+; CHECK-LABEL: @inits(
+; CHECK: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[ARG:%.*]] = mul i32 %roll.iv, 3
+; CHECK-NEXT: [[SLOT:%.*]] = getelementptr inbounds [10 x void (i32)*], [10 x void (i32)*]* @roll.table, i64 0, i32 %roll.iv
+; CHECK-NEXT: [[CALLEE:%.*]] = load void (i32)*, void (i32)** [[SLOT]], align 8
+; CHECK-NEXT: call void [[CALLEE]](i32 [[ARG]])
+; CHECK-NEXT: %roll.iv.next = add i32 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i32 %roll.iv.next, 10
+; DIRECT-LABEL: @inits(
+; DIRECT-NEXT: entry:
+; DIRECT-NEXT: call void @init_0(i32 0)
+define void @inits() {
+entry:
+  call void @init_0(i32 0)
+  call void @init_1(i32 3)
+  call void @init_2(i32 6)
+  call void @init_3(i32 9)
+  call void @init_4(i32 12)
+  call void @init_5(i32 15)
+  call void @init_6(i32 18)
+  call void @init_7(i32 21)
+  call void @init_8(i32 24)
+  call void @init_9(i32 27)
+  ret void
+}
+
+; Three calls save too little code for the load of the callee.
+; LOG: hw1 decision: few: call x 3: kept (loop is not smaller than the group), size 6 -> 7, latency 120 -> 141
+; CHECK-LABEL: @few(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void @init_0(i32 7)
+; CHECK-NEXT: call void @init_1(i32 7)
+; CHECK-NEXT: call void @init_2(i32 7)
+define void @few() {
+entry:
+  call void @init_0(i32 7)
+  call void @init_1(i32 7)
+  call void @init_2(i32 7)
+  ret void
+}
@@ -0,0 +1,13 @@
+# lit configuration of the LLVMHW1 tests. %hw1 runs opt with the pass
+# plugin loaded; the options of the pass follow it on the RUN line.
+import os
+
+import lit.formats
+
+config.name = "LLVMHW1"
+config.test_format = lit.formats.ShTest(True)
+config.suffixes = [".ll"]
+config.test_source_root = os.path.dirname(__file__)
+
+config.environment["PATH"] = os.pathsep.join([config.llvm_tools_dir, config.environment.get("PATH", "")])
+config.substitutions.append(("%hw1", "opt -load %s -load-pass-plugin=%s" % (config.hw1_plugin, config.hw1_plugin)))
@@ -0,0 +1,175 @@
+; Members of a rolled group may differ in alignment, flags and tail call
+; kind; the loop body only keeps what holds for all of them. Members that
+; differ in volatility or call attributes are not rolled.
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+
+; CHECK-LABEL: @align(
+; CHECK: roll.body:
+; CHECK: load i32, i32* %{{.*}}, align 4
+; CHECK-NOT: load
+; CHECK: ret void
+define void @align(i32* %p) {
+entry:
+  %g0 = getelementptr inbounds i32, i32* %p, i64 0
+  %l0 = load i32, i32* %g0, align 16
+  call void @use(i32 %l0)
+  %g1 = getelementptr inbounds i32, i32* %p, i64 1
+  %l1 = load i32, i32* %g1, align 4
+  call void @use(i32 %l1)
+  %g2 = getelementptr inbounds i32, i32* %p, i64 2
+  %l2 = load i32, i32* %g2, align 4
+  call void @use(i32 %l2)
+  %g3 = getelementptr inbounds i32, i32* %p, i64 3
+  %l3 = load i32, i32* %g3, align 4
+  call void @use(i32 %l3)
+  %g4 = getelementptr inbounds i32, i32* %p, i64 4
+  %l4 = load i32, i32* %g4, align 4
+  call void @use(i32 %l4)
+  %g5 = getelementptr inbounds i32, i32* %p, i64 5
+  %l5 = load i32, i32* %g5, align 4
+  call void @use(i32 %l5)
+  %g6 = getelementptr inbounds i32, i32* %p, i64 6
+  %l6 = load i32, i32* %g6, align 4
+  call void @use(i32 %l6)
+  %g7 = getelementptr inbounds i32, i32* %p, i64 7
+  %l7 = load i32, i32* %g7, align 4
+  call void @use(i32 %l7)
+  ret void
+}
+
+; CHECK-LABEL: @volatile(
+; CHECK-NOT: roll.body
+; CHECK: %l2 = load volatile i32
+; CHECK: ret void
+define void @volatile(i32* %p) {
+entry:
+  %g0 = getelementptr inbounds i32, i32* %p, i64 0
+  %l0 = load i32, i32* %g0, align 4
+  call void @use(i32 %l0)
+  %g1 = getelementptr inbounds i32, i32* %p, i64 1
+  %l1 = load i32, i32* %g1, align 4
+  call void @use(i32 %l1)
+  %g2 = getelementptr inbounds i32, i32* %p, i64 2
+  %l2 = load volatile i32, i32* %g2, align 4
+  call void @use(i32 %l2)
+  %g3 = getelementptr inbounds i32, i32* %p, i64 3
+  %l3 = load i32, i32* %g3, align 4
+  call void @use(i32 %l3)
+  %g4 = getelementptr inbounds i32, i32* %p, i64 4
+  %l4 = load i32, i32* %g4, align 4
+  call void @use(i32 %l4)
+  %g5 = getelementptr inbounds i32, i32* %p, i64 5
+  %l5 = load i32, i32* %g5, align 4
+  call void @use(i32 %l5)
+  %g6 = getelementptr inbounds i32, i32* %p, i64 6
+  %l6 = load i32, i32* %g6, align 4
+  call void @use(i32 %l6)
+  %g7 = getelementptr inbounds i32, i32* %p, i64 7
+  %l7 = load i32, i32* %g7, align 4
+  call void @use(i32 %l7)
+  ret void
+}
+
+; CHECK-LABEL: @nsw(
+; CHECK: roll.body:
+; CHECK: add i32 %{{.*}}, 1
+; CHECK: ret void
+define void @nsw(i32* %p) {
+entry:
+  %g0 = getelementptr inbounds i32, i32* %p, i64 0
+  %l0 = load i32, i32* %g0, align 4
+  %a0 = add nsw i32 %l0, 1
+  call void @use(i32 %a0)
+  %g1 = getelementptr inbounds i32, i32* %p, i64 1
+  %l1 = load i32, i32* %g1, align 4
+  %a1 = add i32 %l1, 1
+  call void @use(i32 %a1)
+  %g2 = getelementptr inbounds i32, i32* %p, i64 2
+  %l2 = load i32, i32* %g2, align 4
+  %a2 = add i32 %l2, 1
+  call void @use(i32 %a2)
+  %g3 = getelementptr inbounds i32, i32* %p, i64 3
+  %l3 = load i32, i32* %g3, align 4
+  %a3 = add i32 %l3, 1
+  call void @use(i32 %a3)
+  %g4 = getelementptr inbounds i32, i32* %p, i64 4
+  %l4 = load i32, i32* %g4, align 4
+  %a4 = add i32 %l4, 1
+  call void @use(i32 %a4)
+  %g5 = getelementptr inbounds i32, i32* %p, i64 5
+  %l5 = load i32, i32* %g5, align 4
+  %a5 = add i32 %l5, 1
+  call void @use(i32 %a5)
+  %g6 = getelementptr inbounds i32, i32* %p, i64 6
+  %l6 = load i32, i32* %g6, align 4
+  %a6 = add i32 %l6, 1
+  call void @use(i32 %a6)
+  %g7 = getelementptr inbounds i32, i32* %p, i64 7
+  %l7 = load i32, i32* %g7, align 4
+  %a7 = add i32 %l7, 1
+  call void @use(i32 %a7)
+  ret void
+}
+
+; CHECK-LABEL: @attrs(
+; CHECK-NOT: roll.body
+; CHECK: call void @use(i32 signext 3)
+; CHECK: ret void
+define void @attrs(i32* %p) {
+entry:
+  call void @use(i32 0)
+  call void @use(i32 1)
+  call void @use(i32 2)
+  call void @use(i32 signext 3)
+  call void @use(i32 4)
+  call void @use(i32 5)
+  call void @use(i32 6)
+  call void @use(i32 7)
+  ret void
+}
+
+; CHECK-LABEL: @tail(
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi
+; CHECK-NEXT: {{^  call}} void @use(i32 %roll.iv)
+; CHECK: ret void
+define void @tail(i32* %p) {
+entry:
+  tail call void @use(i32 0)
+  call void @use(i32 1)
+  call void @use(i32 2)
+  call void @use(i32 3)
+  call void @use(i32 4)
+  call void @use(i32 5)
+  call void @use(i32 6)
+  call void @use(i32 7)
+  ret void
+}
+
+; The rerolled loop keeps the first copy of the body, merged with the rest.
+; CHECK-LABEL: @reroll(
+; CHECK: loop:
+; CHECK: %g0 = getelementptr i32, i32* %p, i64 %i
+; CHECK-NEXT: store i32 0, i32* %g0, align 4
+; CHECK-NOT: store
+; CHECK: ret void
+define void @reroll(i32* %p) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i2, %loop ]
+  %g0 = getelementptr inbounds i32, i32* %p, i64 %i
+  store i32 0, i32* %g0, align 16
+  %i1 = add i64 %i, 1
+  %g1 = getelementptr i32, i32* %p, i64 %i1
+  store i32 0, i32* %g1, align 4
+  %i2 = add i64 %i1, 1
+  %c = icmp ult i64 %i2, 64
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+declare void @use(i32)
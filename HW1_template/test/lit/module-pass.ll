@@ -0,0 +1,74 @@
+; -passes=hw1-module decides the functions of a module on -hw1-threads
+; workers and commits them in module order. It rolls what the function
+; pass rolls and logs the decisions in the same order, whatever the number
+; of threads. optnone functions are left alone.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1-module -hw1-threads=1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1-module -hw1-threads=4 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+; RUN: %hw1 -passes=hw1-module -hw1-threads=1 -S %s | FileCheck %s
+; RUN: %hw1 -passes=hw1-module -hw1-threads=4 -S %s | FileCheck %s
+
+declare void @f(i32)
+declare void @g(i64)
+
+; LOG: hw1 decision: first: call x 4: rolled, size 8 -> 5, latency 160 -> 172
+; LOG-NEXT: hw1 decision: second: call x 3: kept (nothing varies between members)
+; LOG-NEXT: hw1 decision: third: call x 5: rolled, size 10 -> 6, latency 200 -> 220
+; LOG-NOT: skipped
+; CHECK-LABEL: @first(
+; CHECK: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: call void @f(i32 %roll.iv)
+; CHECK: %roll.cond = icmp ult i32 %roll.iv.next, 4
+define void @first() {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  call void @f(i32 3)
+  ret void
+}
+
+; CHECK-LABEL: @second(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void @f(i32 7)
+; CHECK-NEXT: call void @f(i32 7)
+; CHECK-NEXT: call void @f(i32 7)
+; CHECK-NEXT: ret void
+define void @second() {
+entry:
+  call void @f(i32 7)
+  call void @f(i32 7)
+  call void @f(i32 7)
+  ret void
+}
+
+; CHECK-LABEL: @third(
+; CHECK: %roll.iv = phi i64 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[A:%.*]] = mul i64 %roll.iv, 2
+; CHECK-NEXT: call void @g(i64 [[A]])
+; CHECK: %roll.cond = icmp ult i64 %roll.iv.next, 5
+define void @third() {
+entry:
+  call void @g(i64 0)
+  call void @g(i64 2)
+  call void @g(i64 4)
+  call void @g(i64 6)
+  call void @g(i64 8)
+  ret void
+}
+
+; CHECK-LABEL: @skipped(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void @f(i32 0)
+; CHECK-NEXT: call void @f(i32 1)
+; CHECK-NEXT: call void @f(i32 2)
+; CHECK-NEXT: call void @f(i32 3)
+define void @skipped() noinline optnone {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  call void @f(i32 3)
+  ret void
+}
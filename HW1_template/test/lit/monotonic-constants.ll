@@ -0,0 +1,36 @@
+; Constant groups are only read as sequences when every member is an
+; integer constant of the same width.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -S %s 2>&1 | FileCheck %s
+
+@g = global i32 0
+@fmt = private constant [4 x i8] c"%d\0A\00"
+
+; CHECK: hw1 decision: not_constant_int: call x 3: kept
+; CHECK: hw1 decision: mixed_widths: call x 3: kept (members differ)
+; CHECK-LABEL: @not_constant_int(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void @use(i64 1)
+; CHECK-NEXT: call void @use(i64 ptrtoint (i32* @g to i64))
+; CHECK-NEXT: call void @use(i64 7)
+define void @not_constant_int() {
+entry:
+  call void @use(i64 1)
+  call void @use(i64 ptrtoint (i32* @g to i64))
+  call void @use(i64 7)
+  ret void
+}
+
+; CHECK-LABEL: @mixed_widths(
+; CHECK-NOT: roll.body
+; CHECK: ret void
+define void @mixed_widths() {
+entry:
+  %f = getelementptr inbounds [4 x i8], [4 x i8]* @fmt, i64 0, i64 0
+  %0 = call i32 (i8*, ...) @printf(i8* %f, i32 1)
+  %1 = call i32 (i8*, ...) @printf(i8* %f, i64 2)
+  %2 = call i32 (i8*, ...) @printf(i8* %f, i32 3)
+  ret void
+}
+
+declare void @use(i64)
+declare i32 @printf(i8*, ...)
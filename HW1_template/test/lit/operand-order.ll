@@ -0,0 +1,77 @@
+; Operands of commutative instructions and compares are read in the order
+; that lines them up with the first member's, so x * 3, 4 * x, ... and
+; x < 0, 1 > x, ... form one group. -hw1-reorder-operands=0 matches them by
+; position and keeps them. Additions of constants align either way, as
+; offsets from their common operand.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -hw1-reorder-operands=0 -disable-output %s 2>&1 | FileCheck %s --check-prefix=OFF
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+
+declare void @f(i32)
+declare void @h(i1)
+
+; LOG: hw1 decision: products: call x 4: rolled, size 12 -> 7, latency 164 -> 180
+; OFF: hw1 decision: products: call x 4: kept (operands do not align)
+; CHECK-LABEL: @products(
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[FACTOR:%.*]] = add i32 %roll.iv, 3
+; CHECK-NEXT: %m0 = mul i32 %x, [[FACTOR]]
+; CHECK-NEXT: call void @f(i32 %m0)
+; CHECK-NEXT: %roll.iv.next = add i32 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i32 %roll.iv.next, 4
+define void @products(i32 %x) {
+entry:
+  %m0 = mul i32 %x, 3
+  call void @f(i32 %m0)
+  %m1 = mul i32 4, %x
+  call void @f(i32 %m1)
+  %m2 = mul i32 %x, 5
+  call void @f(i32 %m2)
+  %m3 = mul i32 6, %x
+  call void @f(i32 %m3)
+  ret void
+}
+
+; LOG: hw1 decision: predicates: call x 4: rolled, size 12 -> 6, latency 164 -> 176
+; OFF: hw1 decision: predicates: call x 4: kept (operands do not align)
+; CHECK-LABEL: @predicates(
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: %c0 = icmp slt i32 %x, %roll.iv
+; CHECK-NEXT: call void @h(i1 %c0)
+define void @predicates(i32 %x) {
+entry:
+  %c0 = icmp slt i32 %x, 0
+  call void @h(i1 %c0)
+  %c1 = icmp sgt i32 1, %x
+  call void @h(i1 %c1)
+  %c2 = icmp slt i32 %x, 2
+  call void @h(i1 %c2)
+  %c3 = icmp sgt i32 3, %x
+  call void @h(i1 %c3)
+  ret void
+}
+
+; LOG: hw1 decision: sums: call x 4: rolled, size 12 -> 7, latency 164 -> 180
+; OFF: hw1 decision: sums: call x 4: rolled, size 12 -> 7, latency 164 -> 180
+; CHECK-LABEL: @sums(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: br label %roll.body
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[OFFSET:%.*]] = add i32 %roll.iv, 3
+; CHECK-NEXT: [[SUM:%.*]] = add i32 %x, [[OFFSET]]
+; CHECK-NEXT: call void @f(i32 [[SUM]])
+define void @sums(i32 %x) {
+entry:
+  %a0 = add i32 %x, 3
+  call void @f(i32 %a0)
+  %a1 = add i32 4, %x
+  call void @f(i32 %a1)
+  %a2 = add i32 %x, 5
+  call void @f(i32 %a2)
+  %a3 = add i32 6, %x
+  call void @f(i32 %a3)
+  ret void
+}
@@ -0,0 +1,74 @@
+; With -hw1-unroll-factor=U the loop body keeps U members of a group and the
+; members left over after the last full iteration stay behind the loop. A
+; group with fewer than U members has no full iteration and is kept.
+; RUN: %hw1 -passes=hw1 -hw1-unroll-factor=4 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -hw1-unroll-factor=4 -S %s | FileCheck %s
+
+declare void @f(i32)
+
+; LOG: hw1 decision: ten: call x 10: rolled, size 16 -> 11, latency 320 -> 326
+; CHECK-LABEL: @ten(
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: call void @f(i32 %roll.iv)
+; CHECK-NEXT: [[A:%.*]] = add i32 %roll.iv, 1
+; CHECK-NEXT: call void @f(i32 [[A]])
+; CHECK-NEXT: [[B:%.*]] = add i32 %roll.iv, 2
+; CHECK-NEXT: call void @f(i32 [[B]])
+; CHECK-NEXT: [[C:%.*]] = add i32 %roll.iv, 3
+; CHECK-NEXT: call void @f(i32 [[C]])
+; CHECK-NEXT: %roll.iv.next = add i32 %roll.iv, 4
+; CHECK-NEXT: %roll.cond = icmp ult i32 %roll.iv.next, 8
+; CHECK-NEXT: br i1 %roll.cond, label %roll.body, label %entry.split
+; CHECK: entry.split:
+; CHECK-NEXT: call void @f(i32 8)
+; CHECK-NEXT: call void @f(i32 9)
+; CHECK-NEXT: ret void
+define void @ten() {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  call void @f(i32 3)
+  call void @f(i32 4)
+  call void @f(i32 5)
+  call void @f(i32 6)
+  call void @f(i32 7)
+  call void @f(i32 8)
+  call void @f(i32 9)
+  ret void
+}
+
+; LOG: hw1 decision: eight: call x 8: rolled, size 16 -> 11, latency 320 -> 326
+; CHECK-LABEL: @eight(
+; CHECK: %roll.iv.next = add i32 %roll.iv, 4
+; CHECK-NEXT: %roll.cond = icmp ult i32 %roll.iv.next, 8
+; CHECK: entry.split:
+; CHECK-NEXT: ret void
+define void @eight() {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  call void @f(i32 3)
+  call void @f(i32 4)
+  call void @f(i32 5)
+  call void @f(i32 6)
+  call void @f(i32 7)
+  ret void
+}
+
+; LOG: hw1 decision: three: call x 3: kept (too few members for the unroll factor)
+; CHECK-LABEL: @three(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void @f(i32 0)
+; CHECK-NEXT: call void @f(i32 1)
+; CHECK-NEXT: call void @f(i32 2)
+; CHECK-NEXT: ret void
+define void @three() {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  ret void
+}
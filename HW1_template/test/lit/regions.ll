@@ -0,0 +1,75 @@
+; Seeds are gathered over regions of control-equivalent blocks. Members split
+; across blocks that fall through into each other are rolled as one group
+; after the blocks are joined; members in blocks with control flow between
+; them are rolled per block and the branches stay.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+
+declare void @f(i32)
+declare void @g(i32)
+
+; LOG: hw1 decision: split: call x 6: rolled, size 12 -> 5, latency 240 -> 258
+; CHECK-LABEL: @split(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: br label %roll.body
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: call void @f(i32 %roll.iv)
+; CHECK-NEXT: %roll.iv.next = add i32 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i32 %roll.iv.next, 6
+; CHECK-NEXT: br i1 %roll.cond, label %roll.body, label %entry.split
+; CHECK: entry.split:
+; CHECK-NEXT: ret void
+; CHECK-NEXT: }
+define void @split() {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  br label %next
+
+next:
+  call void @f(i32 2)
+  call void @f(i32 3)
+  br label %last
+
+last:
+  call void @f(i32 4)
+  call void @f(i32 5)
+  ret void
+}
+
+; %entry and %join always run together, but %then may run between them.
+; LOG: hw1 decision: diamond: call x 3: rolled, size 6 -> 5, latency 120 -> 129
+; LOG-NEXT: hw1 decision: diamond: call x 3: rolled, size 6 -> 5, latency 120 -> 129
+; CHECK-LABEL: @diamond(
+; CHECK: roll.body:
+; CHECK: %roll.cond = icmp ult i32 %roll.iv.next, 3
+; CHECK: entry.split:
+; CHECK-NEXT: br i1 %c, label %then, label %join
+; CHECK: then:
+; CHECK-NEXT: call void @g(i32 0)
+; CHECK-NEXT: br label %join
+; CHECK: join:
+; CHECK-NEXT: br label %[[BODY:roll.body[0-9]+]]
+; CHECK: [[BODY]]:
+; CHECK-NEXT: [[IV:%roll.iv[0-9]+]] = phi i32 [ 0, %join ]
+; CHECK-NEXT: call void @f(i32 [[IV]])
+; CHECK: join.split:
+; CHECK-NEXT: ret void
+define void @diamond(i1 %c) {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  br i1 %c, label %then, label %join
+
+then:
+  call void @g(i32 0)
+  br label %join
+
+join:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  ret void
+}
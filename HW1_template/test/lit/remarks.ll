@@ -0,0 +1,62 @@
+; The pass prints nothing unless asked to. Rolled groups are reported as
+; passed optimization remarks and groups that stay as missed ones, on the
+; command line or as YAML with -pass-remarks-output.
+; RUN: %hw1 -passes=hw1 -disable-output %s 2>&1 | FileCheck %s --allow-empty --check-prefix=QUIET
+; RUN: %hw1 -passes=hw1 -pass-remarks=hw1 -pass-remarks-missed=hw1 -disable-output %s 2>&1 | FileCheck %s --check-prefix=REMARK
+; RUN: %hw1 -passes=hw1 -pass-remarks-output=%t.yaml -disable-output %s
+; RUN: FileCheck %s --check-prefix=YAML < %t.yaml
+
+; QUIET-NOT: {{.}}
+
+declare void @f(i32)
+
+; REMARK: remark: <unknown>:0:0: group of 5 call rolled into a loop of 5 iterations (size 10 -> 5)
+; YAML: --- !Passed
+; YAML-NEXT: Pass: hw1
+; YAML-NEXT: Name: Rolled
+; YAML-NEXT: Function: five
+; YAML-NEXT: Args:
+; YAML-NEXT:   - String: 'group of '
+; YAML-NEXT:   - Members: '5'
+; YAML-NEXT:   - String: ' '
+; YAML-NEXT:   - Opcode: call
+; YAML-NEXT:   - String: ' rolled into a loop of '
+; YAML-NEXT:   - TripCount: '5'
+; YAML-NEXT:   - String: ' iterations'
+; YAML-NEXT:   - String: ' (size '
+; YAML-NEXT:   - SizeBefore: '10'
+; YAML-NEXT:   - String: ' -> '
+; YAML-NEXT:   - SizeAfter: '5'
+; YAML-NEXT:   - String: ')'
+; YAML-NEXT: ...
+define void @five() {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  call void @f(i32 3)
+  call void @f(i32 4)
+  ret void
+}
+
+; REMARK-NEXT: remark: <unknown>:0:0: group of 4 call not rolled: nothing varies between members
+; YAML: --- !Missed
+; YAML-NEXT: Pass: hw1
+; YAML-NEXT: Name: NotRolled
+; YAML-NEXT: Function: same
+; YAML-NEXT: Args:
+; YAML-NEXT:   - String: 'group of '
+; YAML-NEXT:   - Members: '4'
+; YAML-NEXT:   - String: ' '
+; YAML-NEXT:   - Opcode: call
+; YAML-NEXT:   - String: ' not rolled: '
+; YAML-NEXT:   - Reason: nothing varies between members
+; YAML-NEXT: ...
+define void @same() {
+entry:
+  call void @f(i32 5)
+  call void @f(i32 5)
+  call void @f(i32 5)
+  call void @f(i32 5)
+  ret void
+}
@@ -0,0 +1,136 @@
+; Loops that -loop-unroll left with k copies of their body are rerolled
+; whether the copies chain their induction steps, as -loop-unroll emits
+; them, or take every step straight from the phi, as instcombine leaves
+; them. instcombine may also turn the steps into ors and test the phi
+; against a lowered bound instead of testing the last step.
+; The lone stores left after rerolling are not logged as groups.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG --implicit-check-not="single member"
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+
+; LOG: hw1 decision: chained: loop %loop: rerolled 3 copies
+; CHECK-LABEL: @chained(
+; CHECK: loop:
+; CHECK-NEXT: %i = phi i64 [ 0, %entry ], [ %i1, %loop ]
+; CHECK-NEXT: %g0 = getelementptr inbounds i32, i32* %p, i64 %i
+; CHECK-NEXT: store i32 7, i32* %g0, align 4
+; CHECK-NEXT: %i1 = add nuw nsw i64 %i, 1
+; CHECK-NEXT: %c = icmp ult i64 %i1, 96
+; CHECK-NEXT: br i1 %c, label %loop, label %exit
+define void @chained(i32* %p) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i3, %loop ]
+  %g0 = getelementptr inbounds i32, i32* %p, i64 %i
+  store i32 7, i32* %g0, align 4
+  %i1 = add nuw nsw i64 %i, 1
+  %g1 = getelementptr inbounds i32, i32* %p, i64 %i1
+  store i32 7, i32* %g1, align 4
+  %i2 = add nuw nsw i64 %i1, 1
+  %g2 = getelementptr inbounds i32, i32* %p, i64 %i2
+  store i32 7, i32* %g2, align 4
+  %i3 = add nuw nsw i64 %i2, 1
+  %c = icmp ult i64 %i3, 96
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; LOG: hw1 decision: from_phi: loop %loop: rerolled 3 copies
+; CHECK-LABEL: @from_phi(
+; CHECK: loop:
+; CHECK-NEXT: %i = phi i64 [ 1, %entry ], [ %i1, %loop ]
+; CHECK-NEXT: %g0 = getelementptr inbounds i32, i32* %p, i64 %i
+; CHECK-NEXT: store i32 7, i32* %g0, align 4
+; CHECK-NEXT: %i1 = add nuw nsw i64 %i, 1
+; CHECK-NEXT: %c = icmp ult i64 %i1, 97
+; CHECK-NEXT: br i1 %c, label %loop, label %exit
+define void @from_phi(i32* %p) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 1, %entry ], [ %i3, %loop ]
+  %g0 = getelementptr inbounds i32, i32* %p, i64 %i
+  store i32 7, i32* %g0, align 4
+  %i1 = add nuw nsw i64 %i, 1
+  %g1 = getelementptr inbounds i32, i32* %p, i64 %i1
+  store i32 7, i32* %g1, align 4
+  %i2 = add nuw nsw i64 %i, 2
+  %g2 = getelementptr inbounds i32, i32* %p, i64 %i2
+  store i32 7, i32* %g2, align 4
+  %i3 = add nuw nsw i64 %i, 3
+  %c = icmp ult i64 %i3, 97
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; The ors only add while %i is a multiple of 4, so the rerolled loop
+; advances by an add, and the test of %i against 124 becomes a test of the
+; step against 128.
+; LOG: hw1 decision: disjoint_or: loop %loop: rerolled 4 copies
+; CHECK-LABEL: @disjoint_or(
+; CHECK: loop:
+; CHECK-NEXT: %i = phi i64 [ 0, %entry ], [ %i1, %loop ]
+; CHECK-NEXT: %g0 = getelementptr inbounds i32, i32* %p, i64 %i
+; CHECK-NEXT: store i32 7, i32* %g0, align 4
+; CHECK-NEXT: %i1 = add nuw nsw i64 %i, 1
+; CHECK-NEXT: %c = icmp ult i64 %i1, 128
+; CHECK-NEXT: br i1 %c, label %loop, label %exit
+define void @disjoint_or(i32* %p) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i4, %loop ]
+  %g0 = getelementptr inbounds i32, i32* %p, i64 %i
+  store i32 7, i32* %g0, align 4
+  %i1 = or i64 %i, 1
+  %g1 = getelementptr inbounds i32, i32* %p, i64 %i1
+  store i32 7, i32* %g1, align 4
+  %i2 = or i64 %i, 2
+  %g2 = getelementptr inbounds i32, i32* %p, i64 %i2
+  store i32 7, i32* %g2, align 4
+  %i3 = or i64 %i, 3
+  %g3 = getelementptr inbounds i32, i32* %p, i64 %i3
+  store i32 7, i32* %g3, align 4
+  %i4 = add nuw nsw i64 %i, 4
+  %c = icmp ult i64 %i, 124
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; The 98 - 1 = 97 steps to the bound are not a multiple of the 3 copies; the
+; rerolled loop would stop at 98 where the unrolled one never does, so the
+; copies stay and only the stores are rolled.
+; LOG-NOT: uneven: loop
+; LOG: hw1 decision: uneven: store x 3: rolled
+; CHECK-LABEL: @uneven(
+; CHECK: %i3 = add nuw nsw i64 %i, 3
+define void @uneven(i32* %p) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 1, %entry ], [ %i3, %loop ]
+  %g0 = getelementptr inbounds i32, i32* %p, i64 %i
+  store i32 7, i32* %g0, align 4
+  %i1 = add nuw nsw i64 %i, 1
+  %g1 = getelementptr inbounds i32, i32* %p, i64 %i1
+  store i32 7, i32* %g1, align 4
+  %i2 = add nuw nsw i64 %i, 2
+  %g2 = getelementptr inbounds i32, i32* %p, i64 %i2
+  store i32 7, i32* %g2, align 4
+  %i3 = add nuw nsw i64 %i, 3
+  %c = icmp ne i64 %i3, 98
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
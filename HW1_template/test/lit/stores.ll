@@ -0,0 +1,72 @@
+; Store groups are rolled into a counted loop like call groups, and
+; -hw1-report-size reports the instruction count before and after.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -hw1-report-size -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+
+; in[i] = 0 unrolled six times; in itself is the first address.
+; LOG: hw1 decision: zero: store x 6: rolled, size 11 -> 6
+; LOG-NEXT: hw1 size: zero: 12 -> 11 instructions, 1 groups rolled, 0 in hot blocks
+; CHECK-LABEL: @zero(
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i64 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[OFF:%.*]] = mul i64 %roll.iv, 4
+; CHECK-NEXT: [[BYTES:%.*]] = bitcast i32* %in to i8*
+; CHECK-NEXT: [[GEP:%.*]] = getelementptr i8, i8* [[BYTES]], i64 [[OFF]]
+; CHECK-NEXT: [[PTR:%.*]] = bitcast i8* [[GEP]] to i32*
+; CHECK-NEXT: store i32 0, i32* [[PTR]], align 4
+; CHECK-NEXT: %roll.iv.next = add i64 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i64 %roll.iv.next, 6
+; CHECK-NEXT: br i1 %roll.cond, label %roll.body, label %entry.split
+; CHECK-NOT: store
+; CHECK: ret void
+define void @zero(i32* %in) {
+entry:
+  %g1 = getelementptr inbounds i32, i32* %in, i64 1
+  %g2 = getelementptr inbounds i32, i32* %in, i64 2
+  %g3 = getelementptr inbounds i32, i32* %in, i64 3
+  %g4 = getelementptr inbounds i32, i32* %in, i64 4
+  %g5 = getelementptr inbounds i32, i32* %in, i64 5
+  store i32 0, i32* %in, align 4
+  store i32 0, i32* %g1, align 4
+  store i32 0, i32* %g2, align 4
+  store i32 0, i32* %g3, align 4
+  store i32 0, i32* %g4, align 4
+  store i32 0, i32* %g5, align 4
+  ret void
+}
+
+; in[j] += 10 unrolled three times: the load, add and store of each copy
+; follow the index j + k, and the offsets j + 1, j + 2 go with the group.
+; LOG: hw1 decision: add_ten: store x 3: rolled, size 14 -> 8
+; LOG-NEXT: hw1 size: add_ten: 15 -> 11 instructions, 1 groups rolled, 0 in hot blocks
+; CHECK-LABEL: @add_ten(
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i64 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[J:%.*]] = add i64 %j, %roll.iv
+; CHECK-NEXT: %p0 = getelementptr inbounds i32, i32* %in, i64 [[J]]
+; CHECK-NEXT: %v0 = load i32, i32* %p0, align 4
+; CHECK-NEXT: %a0 = add nsw i32 %v0, 10
+; CHECK-NEXT: store i32 %a0, i32* %p0, align 4
+; CHECK-NEXT: %roll.iv.next = add i64 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i64 %roll.iv.next, 3
+; CHECK-NOT: %j1
+; CHECK-NOT: store
+; CHECK: ret void
+define void @add_ten(i32* %in, i64 %j) {
+entry:
+  %p0 = getelementptr inbounds i32, i32* %in, i64 %j
+  %v0 = load i32, i32* %p0, align 4
+  %a0 = add nsw i32 %v0, 10
+  store i32 %a0, i32* %p0, align 4
+  %j1 = add nsw i64 %j, 1
+  %p1 = getelementptr inbounds i32, i32* %in, i64 %j1
+  %v1 = load i32, i32* %p1, align 4
+  %a1 = add nsw i32 %v1, 10
+  store i32 %a1, i32* %p1, align 4
+  %j2 = add nsw i64 %j, 2
+  %p2 = getelementptr inbounds i32, i32* %in, i64 %j2
+  %v2 = load i32, i32* %p2, align 4
+  %a2 = add nsw i32 %v2, 10
+  store i32 %a2, i32* %p2, align 4
+  ret void
+}
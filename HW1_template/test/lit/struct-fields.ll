@@ -0,0 +1,79 @@
+; GEPs into structs are matched as byte offsets from a common base, so
+; fields printed one after the other and the same field of consecutive
+; elements roll into a loop that steps through the bytes. The GEP of the
+; first member is computed in the loop like the others and does not stay
+; behind in the entry block.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+
+%struct.Box = type { i32, i32, i32, i32, i32 }
+%struct.Pair = type { i64, i32 }
+
+declare void @print(i32)
+
+; LOG: hw1 decision: fields: call x 5: rolled, size 19 -> 9, latency 224 -> 250
+; CHECK-LABEL: @fields(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: br label %roll.body
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i64 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[SCALED:%.*]] = mul i64 %roll.iv, -4
+; CHECK-NEXT: [[OFFSET:%.*]] = add i64 [[SCALED]], 16
+; CHECK-NEXT: [[BYTES:%.*]] = bitcast %struct.Box* %b to i8*
+; CHECK-NEXT: [[FIELD:%.*]] = getelementptr i8, i8* [[BYTES]], i64 [[OFFSET]]
+; CHECK-NEXT: [[PTR:%.*]] = bitcast i8* [[FIELD]] to i32*
+; CHECK-NEXT: [[VALUE:%.*]] = load i32, i32* [[PTR]], align 4
+; CHECK-NEXT: call void @print(i32 [[VALUE]])
+; CHECK-NEXT: %roll.iv.next = add i64 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i64 %roll.iv.next, 5
+; CHECK-NEXT: br i1 %roll.cond, label %roll.body, label %entry.split
+; CHECK: entry.split:
+; CHECK-NEXT: ret void
+define void @fields(%struct.Box* %b) {
+entry:
+  %h = getelementptr inbounds %struct.Box, %struct.Box* %b, i32 0, i32 4
+  %0 = load i32, i32* %h, align 4
+  call void @print(i32 %0)
+  %w = getelementptr inbounds %struct.Box, %struct.Box* %b, i32 0, i32 3
+  %1 = load i32, i32* %w, align 4
+  call void @print(i32 %1)
+  %l = getelementptr inbounds %struct.Box, %struct.Box* %b, i32 0, i32 2
+  %2 = load i32, i32* %l, align 4
+  call void @print(i32 %2)
+  %g = getelementptr inbounds %struct.Box, %struct.Box* %b, i32 0, i32 1
+  %3 = load i32, i32* %g, align 4
+  call void @print(i32 %3)
+  %i = getelementptr inbounds %struct.Box, %struct.Box* %b, i32 0, i32 0
+  %4 = load i32, i32* %i, align 4
+  call void @print(i32 %4)
+  ret void
+}
+
+; LOG: hw1 decision: strided: store x 4: rolled, size 8 -> 7, latency 8 -> 28
+; CHECK-LABEL: @strided(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: br label %roll.body
+; CHECK: roll.body:
+; CHECK-NEXT: %roll.iv = phi i64 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[SCALED:%.*]] = mul i64 %roll.iv, 16
+; CHECK-NEXT: [[OFFSET:%.*]] = add i64 [[SCALED]], 8
+; CHECK-NEXT: [[BYTES:%.*]] = bitcast %struct.Pair* %p to i8*
+; CHECK-NEXT: [[FIELD:%.*]] = getelementptr i8, i8* [[BYTES]], i64 [[OFFSET]]
+; CHECK-NEXT: [[PTR:%.*]] = bitcast i8* [[FIELD]] to i32*
+; CHECK-NEXT: store i32 0, i32* [[PTR]], align 4
+; CHECK-NEXT: %roll.iv.next = add i64 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i64 %roll.iv.next, 4
+define void @strided(%struct.Pair* %p) {
+entry:
+  %a = getelementptr inbounds %struct.Pair, %struct.Pair* %p, i64 0, i32 1
+  store i32 0, i32* %a, align 4
+  %b = getelementptr inbounds %struct.Pair, %struct.Pair* %p, i64 1, i32 1
+  store i32 0, i32* %b, align 4
+  %c = getelementptr inbounds %struct.Pair, %struct.Pair* %p, i64 2, i32 1
+  store i32 0, i32* %c, align 4
+  %d = getelementptr inbounds %struct.Pair, %struct.Pair* %p, i64 3, i32 1
+  store i32 0, i32* %d, align 4
+  ret void
+}
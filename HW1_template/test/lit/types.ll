@@ -0,0 +1,91 @@
+; Members are matched on their exact types, so arguments of different widths
+; do not form a group. The induction variable is the narrowest legal type
+; that holds the trip count, unless every sequence already has one wide
+; enough legal type; sequences of other types extend it once per iteration.
+; -hw1-widen-casts lets extensions from different widths share a group
+; through one cast per iteration from the widest source type.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+; RUN: %hw1 -passes=hw1 -hw1-widen-casts=0 -S %s | FileCheck %s --check-prefix=NARROW
+
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+
+declare void @f(i32)
+declare void @g(i32, i64)
+declare void @v(...)
+
+; LOG: hw1 decision: same_type: call x 5: rolled, size 10 -> 5, latency 200 -> 215
+; CHECK-LABEL: @same_type(
+; CHECK: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: call void @f(i32 %roll.iv)
+; CHECK-NEXT: %roll.iv.next = add i32 %roll.iv, 1
+define void @same_type() {
+entry:
+  call void @f(i32 0)
+  call void @f(i32 1)
+  call void @f(i32 2)
+  call void @f(i32 3)
+  call void @f(i32 4)
+  ret void
+}
+
+; LOG: hw1 decision: mixed_types: call x 5: rolled, size 15 -> 9, latency 200 -> 230
+; CHECK-LABEL: @mixed_types(
+; CHECK: %roll.iv = phi i8 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[A:%.*]] = sext i8 %roll.iv to i32
+; CHECK-NEXT: [[B:%.*]] = sext i8 %roll.iv to i64
+; CHECK-NEXT: [[C:%.*]] = add i64 [[B]], 10
+; CHECK-NEXT: call void @g(i32 [[A]], i64 [[C]])
+; CHECK-NEXT: %roll.iv.next = add i8 %roll.iv, 1
+; CHECK-NEXT: %roll.cond = icmp ult i8 %roll.iv.next, 5
+define void @mixed_types() {
+entry:
+  call void @g(i32 0, i64 10)
+  call void @g(i32 1, i64 11)
+  call void @g(i32 2, i64 12)
+  call void @g(i32 3, i64 13)
+  call void @g(i32 4, i64 14)
+  ret void
+}
+
+; LOG: hw1 decision: widths: call x 4: kept (members differ)
+; CHECK-LABEL: @widths(
+; CHECK-NOT: roll.body
+; CHECK: call void (...) @v(i64 3)
+define void @widths() {
+entry:
+  call void (...) @v(i32 0)
+  call void (...) @v(i64 1)
+  call void (...) @v(i32 2)
+  call void (...) @v(i64 3)
+  ret void
+}
+
+; Without -hw1-widen-casts the casts do not match; SCEV still finds the
+; later ones a constant distance from the first, which stays as the base.
+; LOG: hw1 decision: widened: call x 4: rolled, size 12 -> 7, latency 164 -> 180
+; CHECK-LABEL: @widened(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: br label %roll.body
+; CHECK: %roll.iv = phi i16 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; CHECK-NEXT: [[SOURCE:%.*]] = add i16 %roll.iv, 1
+; CHECK-NEXT: %s0 = sext i16 [[SOURCE]] to i32
+; CHECK-NEXT: call void @f(i32 %s0)
+; NARROW-LABEL: @widened(
+; NARROW-NEXT: entry:
+; NARROW-NEXT: %s0 = sext i8 1 to i32
+; NARROW: %roll.iv = phi i32 [ 0, %entry ], [ %roll.iv.next, %roll.body ]
+; NARROW-NEXT: [[VALUE:%.*]] = add i32 %s0, %roll.iv
+; NARROW-NEXT: call void @f(i32 [[VALUE]])
+define void @widened() {
+entry:
+  %s0 = sext i8 1 to i32
+  call void @f(i32 %s0)
+  %s1 = sext i16 2 to i32
+  call void @f(i32 %s1)
+  %s2 = sext i8 3 to i32
+  call void @f(i32 %s2)
+  %s3 = sext i16 4 to i32
+  call void @f(i32 %s3)
+  ret void
+}
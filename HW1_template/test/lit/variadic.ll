@@ -0,0 +1,51 @@
+; Calls to a variadic function are only grouped with calls that pass the
+; same number of arguments. Mixing arities used to read operands past the
+; end of the shorter calls.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+
+@fmt = private constant [4 x i8] c"%d\0A\00"
+
+; LOG: hw1 decision: interleaved: call x 4: kept
+; LOG: hw1 decision: interleaved: call x 4: kept
+; CHECK-LABEL: @interleaved(
+; CHECK-NOT: roll.body
+; CHECK: ret void
+define void @interleaved(i32 %a, i32 %b) {
+entry:
+  %f = getelementptr inbounds [4 x i8], [4 x i8]* @fmt, i64 0, i64 0
+  %0 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 %b, i32 1, i32 0)
+  %1 = call i32 (i8*, ...) @printf(i8* %f)
+  %2 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 %b, i32 2, i32 0)
+  %3 = call i32 (i8*, ...) @printf(i8* %f)
+  %4 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 %b, i32 3, i32 0)
+  %5 = call i32 (i8*, ...) @printf(i8* %f)
+  %6 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 %b, i32 4, i32 0)
+  %7 = call i32 (i8*, ...) @printf(i8* %f)
+  ret void
+}
+
+; LOG: hw1 decision: adjacent: call x 8: rolled
+; CHECK-LABEL: @adjacent(
+; CHECK: roll.body:
+; CHECK: call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 %roll.iv)
+; CHECK: call i32 (i8*, ...) @printf(i8* %f)
+; CHECK-NEXT: call i32 (i8*, ...) @printf(i8* %f)
+; CHECK-NEXT: ret void
+define void @adjacent(i32 %a) {
+entry:
+  %f = getelementptr inbounds [4 x i8], [4 x i8]* @fmt, i64 0, i64 0
+  %0 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 0)
+  %1 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 1)
+  %2 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 2)
+  %3 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 3)
+  %4 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 4)
+  %5 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 5)
+  %6 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 6)
+  %7 = call i32 (i8*, ...) @printf(i8* %f, i32 %a, i32 7)
+  %8 = call i32 (i8*, ...) @printf(i8* %f)
+  %9 = call i32 (i8*, ...) @printf(i8* %f)
+  ret void
+}
+
+declare i32 @printf(i8*, ...)
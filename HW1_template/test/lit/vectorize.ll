@@ -0,0 +1,175 @@
+; On a target with vector registers a load-add-store group whose lanes
+; fill whole registers is emitted as straight-line vector code when that is
+; no larger than the loop; -hw1-vectorize=0 rolls it as before. With an
+; unroll factor the vector code is compared against the unrolled loop, which
+; is the one that would be emitted instead.
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -disable-output %s 2>&1 | FileCheck %s --check-prefix=LOG
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -hw1-vectorize=0 -disable-output %s 2>&1 | FileCheck %s --check-prefix=SCALAR
+; RUN: %hw1 -passes=hw1 -hw1-decision-log -hw1-unroll-factor=2 -disable-output %s 2>&1 | FileCheck %s --check-prefix=UNROLL
+; RUN: %hw1 -passes=hw1 -S %s | FileCheck %s
+; RUN: %hw1 -passes=hw1 -hw1-vectorize=0 -S %s | FileCheck %s --check-prefix=LOOP
+
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; LOG: hw1 decision: v8: store x 8: vectorized, 4 lanes, size 24 -> 6, latency 48 -> 6
+; SCALAR: hw1 decision: v8: store x 8: rolled, size 24 -> 9, latency 48 -> 96
+; UNROLL: hw1 decision: v8: store x 8: vectorized, 4 lanes, size 24 -> 6, latency 48 -> 6
+; CHECK-LABEL: @v8(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: [[S0:%.*]] = bitcast i32* %src to <4 x i32>*
+; CHECK-NEXT: [[L0:%.*]] = load <4 x i32>, <4 x i32>* [[S0]], align 4
+; CHECK-NEXT: [[A0:%.*]] = add nsw <4 x i32> [[L0]], <i32 7, i32 7, i32 7, i32 7>
+; CHECK-NEXT: [[D0:%.*]] = bitcast i32* %dst to <4 x i32>*
+; CHECK-NEXT: store <4 x i32> [[A0]], <4 x i32>* [[D0]], align 4
+; CHECK-NEXT: [[SB:%.*]] = bitcast i32* %src to i8*
+; CHECK-NEXT: [[SG:%.*]] = getelementptr i8, i8* [[SB]], i64 16
+; CHECK-NEXT: [[SI:%.*]] = bitcast i8* [[SG]] to i32*
+; CHECK-NEXT: [[S1:%.*]] = bitcast i32* [[SI]] to <4 x i32>*
+; CHECK-NEXT: [[L1:%.*]] = load <4 x i32>, <4 x i32>* [[S1]], align 4
+; CHECK-NEXT: [[A1:%.*]] = add nsw <4 x i32> [[L1]], <i32 7, i32 7, i32 7, i32 7>
+; CHECK-NEXT: [[DB:%.*]] = bitcast i32* %dst to i8*
+; CHECK-NEXT: [[DG:%.*]] = getelementptr i8, i8* [[DB]], i64 16
+; CHECK-NEXT: [[DI:%.*]] = bitcast i8* [[DG]] to i32*
+; CHECK-NEXT: [[D1:%.*]] = bitcast i32* [[DI]] to <4 x i32>*
+; CHECK-NEXT: store <4 x i32> [[A1]], <4 x i32>* [[D1]], align 4
+; CHECK-NEXT: ret void
+; LOOP-LABEL: @v8(
+; LOOP: roll.body:
+; LOOP-NOT: <4 x i32>
+; LOOP: %a0 = add nsw i32 %l0, 7
+; LOOP: %roll.cond = icmp ult i64 %roll.iv.next, 8
+define void @v8(i32* noalias %dst, i32* noalias %src) {
+entry:
+  %l0 = load i32, i32* %src, align 4
+  %a0 = add nsw i32 %l0, 7
+  store i32 %a0, i32* %dst, align 4
+  %ps1 = getelementptr inbounds i32, i32* %src, i64 1
+  %l1 = load i32, i32* %ps1, align 4
+  %a1 = add nsw i32 %l1, 7
+  %pd1 = getelementptr inbounds i32, i32* %dst, i64 1
+  store i32 %a1, i32* %pd1, align 4
+  %ps2 = getelementptr inbounds i32, i32* %src, i64 2
+  %l2 = load i32, i32* %ps2, align 4
+  %a2 = add nsw i32 %l2, 7
+  %pd2 = getelementptr inbounds i32, i32* %dst, i64 2
+  store i32 %a2, i32* %pd2, align 4
+  %ps3 = getelementptr inbounds i32, i32* %src, i64 3
+  %l3 = load i32, i32* %ps3, align 4
+  %a3 = add nsw i32 %l3, 7
+  %pd3 = getelementptr inbounds i32, i32* %dst, i64 3
+  store i32 %a3, i32* %pd3, align 4
+  %ps4 = getelementptr inbounds i32, i32* %src, i64 4
+  %l4 = load i32, i32* %ps4, align 4
+  %a4 = add nsw i32 %l4, 7
+  %pd4 = getelementptr inbounds i32, i32* %dst, i64 4
+  store i32 %a4, i32* %pd4, align 4
+  %ps5 = getelementptr inbounds i32, i32* %src, i64 5
+  %l5 = load i32, i32* %ps5, align 4
+  %a5 = add nsw i32 %l5, 7
+  %pd5 = getelementptr inbounds i32, i32* %dst, i64 5
+  store i32 %a5, i32* %pd5, align 4
+  %ps6 = getelementptr inbounds i32, i32* %src, i64 6
+  %l6 = load i32, i32* %ps6, align 4
+  %a6 = add nsw i32 %l6, 7
+  %pd6 = getelementptr inbounds i32, i32* %dst, i64 6
+  store i32 %a6, i32* %pd6, align 4
+  %ps7 = getelementptr inbounds i32, i32* %src, i64 7
+  %l7 = load i32, i32* %ps7, align 4
+  %a7 = add nsw i32 %l7, 7
+  %pd7 = getelementptr inbounds i32, i32* %dst, i64 7
+  store i32 %a7, i32* %pd7, align 4
+  ret void
+}
+
+; Sixteen lanes take four vector groups, more than the rolled loop; unrolled
+; by two the loop is larger again and the vector code wins.
+; LOG: hw1 decision: v16: store x 16: rolled, size 48 -> 9, latency 96 -> 192
+; SCALAR: hw1 decision: v16: store x 16: rolled, size 48 -> 9, latency 96 -> 192
+; UNROLL: hw1 decision: v16: store x 16: vectorized, 4 lanes, size 48 -> 12, latency 96 -> 12
+; CHECK-LABEL: @v16(
+; CHECK: roll.body:
+; CHECK-NOT: <4 x i32>
+; CHECK: %roll.cond = icmp ult i64 %roll.iv.next, 16
+define void @v16(i32* noalias %dst, i32* noalias %src) {
+entry:
+  %l0 = load i32, i32* %src, align 4
+  %a0 = add nsw i32 %l0, 7
+  store i32 %a0, i32* %dst, align 4
+  %ps1 = getelementptr inbounds i32, i32* %src, i64 1
+  %l1 = load i32, i32* %ps1, align 4
+  %a1 = add nsw i32 %l1, 7
+  %pd1 = getelementptr inbounds i32, i32* %dst, i64 1
+  store i32 %a1, i32* %pd1, align 4
+  %ps2 = getelementptr inbounds i32, i32* %src, i64 2
+  %l2 = load i32, i32* %ps2, align 4
+  %a2 = add nsw i32 %l2, 7
+  %pd2 = getelementptr inbounds i32, i32* %dst, i64 2
+  store i32 %a2, i32* %pd2, align 4
+  %ps3 = getelementptr inbounds i32, i32* %src, i64 3
+  %l3 = load i32, i32* %ps3, align 4
+  %a3 = add nsw i32 %l3, 7
+  %pd3 = getelementptr inbounds i32, i32* %dst, i64 3
+  store i32 %a3, i32* %pd3, align 4
+  %ps4 = getelementptr inbounds i32, i32* %src, i64 4
+  %l4 = load i32, i32* %ps4, align 4
+  %a4 = add nsw i32 %l4, 7
+  %pd4 = getelementptr inbounds i32, i32* %dst, i64 4
+  store i32 %a4, i32* %pd4, align 4
+  %ps5 = getelementptr inbounds i32, i32* %src, i64 5
+  %l5 = load i32, i32* %ps5, align 4
+  %a5 = add nsw i32 %l5, 7
+  %pd5 = getelementptr inbounds i32, i32* %dst, i64 5
+  store i32 %a5, i32* %pd5, align 4
+  %ps6 = getelementptr inbounds i32, i32* %src, i64 6
+  %l6 = load i32, i32* %ps6, align 4
+  %a6 = add nsw i32 %l6, 7
+  %pd6 = getelementptr inbounds i32, i32* %dst, i64 6
+  store i32 %a6, i32* %pd6, align 4
+  %ps7 = getelementptr inbounds i32, i32* %src, i64 7
+  %l7 = load i32, i32* %ps7, align 4
+  %a7 = add nsw i32 %l7, 7
+  %pd7 = getelementptr inbounds i32, i32* %dst, i64 7
+  store i32 %a7, i32* %pd7, align 4
+  %ps8 = getelementptr inbounds i32, i32* %src, i64 8
+  %l8 = load i32, i32* %ps8, align 4
+  %a8 = add nsw i32 %l8, 7
+  %pd8 = getelementptr inbounds i32, i32* %dst, i64 8
+  store i32 %a8, i32* %pd8, align 4
+  %ps9 = getelementptr inbounds i32, i32* %src, i64 9
+  %l9 = load i32, i32* %ps9, align 4
+  %a9 = add nsw i32 %l9, 7
+  %pd9 = getelementptr inbounds i32, i32* %dst, i64 9
+  store i32 %a9, i32* %pd9, align 4
+  %ps10 = getelementptr inbounds i32, i32* %src, i64 10
+  %l10 = load i32, i32* %ps10, align 4
+  %a10 = add nsw i32 %l10, 7
+  %pd10 = getelementptr inbounds i32, i32* %dst, i64 10
+  store i32 %a10, i32* %pd10, align 4
+  %ps11 = getelementptr inbounds i32, i32* %src, i64 11
+  %l11 = load i32, i32* %ps11, align 4
+  %a11 = add nsw i32 %l11, 7
+  %pd11 = getelementptr inbounds i32, i32* %dst, i64 11
+  store i32 %a11, i32* %pd11, align 4
+  %ps12 = getelementptr inbounds i32, i32* %src, i64 12
+  %l12 = load i32, i32* %ps12, align 4
+  %a12 = add nsw i32 %l12, 7
+  %pd12 = getelementptr inbounds i32, i32* %dst, i64 12
+  store i32 %a12, i32* %pd12, align 4
+  %ps13 = getelementptr inbounds i32, i32* %src, i64 13
+  %l13 = load i32, i32* %ps13, align 4
+  %a13 = add nsw i32 %l13, 7
+  %pd13 = getelementptr inbounds i32, i32* %dst, i64 13
+  store i32 %a13, i32* %pd13, align 4
+  %ps14 = getelementptr inbounds i32, i32* %src, i64 14
+  %l14 = load i32, i32* %ps14, align 4
+  %a14 = add nsw i32 %l14, 7
+  %pd14 = getelementptr inbounds i32, i32* %dst, i64 14
+  store i32 %a14, i32* %pd14, align 4
+  %ps15 = getelementptr inbounds i32, i32* %src, i64 15
+  %l15 = load i32, i32* %ps15, align 4
+  %a15 = add nsw i32 %l15, 7
+  %pd15 = getelementptr inbounds i32, i32* %dst, i64 15
+  store i32 %a15, i32* %pd15, align 4
+  ret void
+}
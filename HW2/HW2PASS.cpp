@@ -29,6 +29,9 @@
 #include "llvm/Transforms/Utils/LoopUtils.h"
 #include "llvm/Analysis/BranchProbabilityInfo.h"
 #include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/CommandLine.h"
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
@@ -41,6 +44,8 @@ using namespace llvm;
 
 #define DEBUG_TYPE "fplicm"
 
+static cl::opt<bool> DefaultPipeline("fplicm-in-default-pipeline", cl::init(false),
+    cl::desc("Also run fplicm-correctness at the end of the scalar optimizer of the -O1 and higher pipelines"));
 
 namespace Correctness{
 struct FPLICMPass : public LoopPass {
@@ -48,11 +53,17 @@ struct FPLICMPass : public LoopPass {
   FPLICMPass() : LoopPass(ID) {}
 
   bool runOnLoop(Loop *L, LPPassManager &LPM) override {
+    BranchProbabilityInfo &bpi = getAnalysis<BranchProbabilityInfoWrapperPass>().getBPI();
+    return runFPLICM(L, bpi);
+  }
+
+  // Frequent-path LICM on one loop. Shared with FPLICMNewPass, which only
+  // differs in where bpi comes from.
+  static bool runFPLICM(Loop *L, BranchProbabilityInfo &bpi) {
     bool Changed = false;
 
     /* *******Implementation Starts Here******* */
     
-    BranchProbabilityInfo &bpi = getAnalysis<BranchProbabilityInfoWrapperPass>().getBPI();
     std::vector<BasicBlock*> freqBasicBlocks;
     std::unordered_set<BasicBlock*> visitedFreqBasicBlocks;
     std::unordered_map<Value*, std::vector<LoadInst*>> hoistInstructions;
@@ -138,6 +149,28 @@ private:
   }
 
 };
+
+// New pass manager version. It runs once per function and visits the loops
+// innermost first, like the legacy loop pass manager, but bpi and LoopInfo
+// come from the function analysis manager cache instead of being requested
+// again for every loop.
+struct FPLICMNewPass : public PassInfoMixin<FPLICMNewPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &FAM) {
+    LoopInfo &LI = FAM.getResult<LoopAnalysis>(F);
+    BranchProbabilityInfo &bpi = FAM.getResult<BranchProbabilityAnalysis>(F);
+
+    bool Changed = false;
+    for (Loop *L : reverse(LI.getLoopsInPreorder())) {
+      if (!L->getLoopPreheader()) continue;
+      Changed |= FPLICMPass::runFPLICM(L, bpi);
+    }
+    if (!Changed) return PreservedAnalyses::all();
+
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+  }
+};
 } // end of namespace Correctness
 
 char Correctness::FPLICMPass::ID = 0;
@@ -180,3 +213,25 @@ private:
 
 char Performance::FPLICMPass::ID = 0;
 static RegisterPass<Performance::FPLICMPass> Y("fplicm-performance", "Frequent Loop Invariant Code Motion for performance test", false, false);
+
+
+// Lets fplicm-correctness be loaded with -load-pass-plugin and run as
+// -passes='loop-simplify,fplicm-correctness'. fplicm-performance is still
+// the empty template and stays with the legacy pass manager until it is
+// written. With -fplicm-in-default-pipeline the pass also runs at the end
+// of the scalar optimizer of the default pipelines (-O2, -Os, ...).
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo() {
+  return {LLVM_PLUGIN_API_VERSION, "HW2", LLVM_VERSION_STRING, [](PassBuilder &PB) {
+    PB.registerPipelineParsingCallback(
+        [](StringRef Name, FunctionPassManager &FPM, ArrayRef<PassBuilder::PipelineElement>) {
+          if (Name != "fplicm-correctness") return false;
+          FPM.addPass(Correctness::FPLICMNewPass());
+          return true;
+        });
+    PB.registerScalarOptimizerLateEPCallback(
+        [](FunctionPassManager &FPM, OptimizationLevel Level) {
+          if (Level == OptimizationLevel::O0 || !DefaultPipeline) return;
+          FPM.addPass(Correctness::FPLICMNewPass());
+        });
+  }};
+}